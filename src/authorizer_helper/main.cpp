@@ -19,17 +19,22 @@
 
 
 #include <unistd.h>
+#include <poll.h>
+#include <errno.h>
 #include <sys/stat.h>
 
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QFile>
+#include <QHash>
+#include <QVector>
 #include <QDebug>
 #include <QStandardPaths>
 
 #include <wayland-client.h>
 
 #include "../client/utils.h"
+#include "../compositor/policywatcher.h"
 #include "wayland-authorizer-helper-client-protocol.h"
 
 enum class Result {
@@ -38,11 +43,18 @@ enum class Result {
     Unknown,
 };
 
+// interface -> executable -> result
+typedef QHash<QByteArray, QHash<QByteArray, Result>> Policy;
+
 class Helper {
 public:
     Helper()
         : helper(nullptr)
+        , watcher(nullptr)
     {
+        policyFiles << QStandardPaths::writableLocation(QStandardPaths::ConfigLocation) + QStringLiteral("/orbital/restricted_interfaces.conf")
+                    << QStringLiteral("/etc/orbital/restricted_interfaces.conf");
+        policies.resize(policyFiles.count());
     }
     void global(wl_registry *registry, uint32_t id, const char *interface, uint32_t version)
     {
@@ -75,6 +87,10 @@ public:
         }
         buf[ret] = '\0';
 
+        // Without the watcher we can't know when they change, read them every time
+        if (!watcher) {
+            loadPolicies();
+        }
         if (authorizeProcess(interface, buf)) {
             orbital_authorizer_helper_result_result(result, ORBITAL_AUTHORIZER_HELPER_RESULT_RESULT_VALUE_ALLOW);
         } else {
@@ -85,73 +101,110 @@ public:
 
     bool authorizeProcess(const char *global, const char *executable)
     {
-        QString path = QStandardPaths::writableLocation(QStandardPaths::ConfigLocation);
-        Result res = readFile(path + QStringLiteral("/orbital/restricted_interfaces.conf"), global, executable);
-        if (res == Result::Unknown) {
-            res = readFile(QStringLiteral("/etc/orbital/restricted_interfaces.conf"), global, executable);
+        // the policies are in order of precedence, the first one knowing
+        // about the executable wins
+        for (const Policy &policy: policies) {
+            Result res = policy.value(global).value(executable, Result::Unknown);
+            if (res != Result::Unknown) {
+                return res == Result::Allow;
+            }
+        }
+        return false;
+    }
+
+    void loadPolicies()
+    {
+        for (int i = 0; i < policyFiles.count(); ++i) {
+            policies[i] = readFile(policyFiles.at(i));
         }
-        return res == Result::Allow;
     }
 
-    Result readFile(const QString &path, const char *global, const char *executable)
+    Policy readFile(const QString &path)
     {
         struct stat st;
         if (stat(qPrintable(path), &st) < 0) {
             qWarning("Cannot stat %s\n", qPrintable(path));
-            return Result::Unknown;
+            return Policy();
         }
 
         if (st.st_uid != 0) {
             qWarning("Cannot use %s. The file must be owned by root!", qPrintable(path));
-            return Result::Unknown;
+            return Policy();
         }
 
         if (st.st_mode & S_IWOTH || st.st_mode & S_IWGRP) {
             qWarning("Cannot use %s. The file must not be writable by normal users!", qPrintable(path));
-            return Result::Unknown;
+            return Policy();
         }
 
         QFile file(path);
         if (!file.open(QIODevice::ReadOnly)) {
             qWarning("Cannot open %s", qPrintable(path));
-            return Result::Unknown;
+            return Policy();
         }
 
         QJsonParseError error;
         QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &error);
         if (error.error != QJsonParseError::NoError) {
             qWarning("Error parsing %s at offset %d: %s", qPrintable(path), error.offset, qPrintable(error.errorString()));
-            return Result::Unknown;
+            return Policy();
         }
 
         QJsonObject config = document.object();
         file.close();
 
-        if (!config.contains(global)) {
-            return Result::Unknown;
+        Policy policy;
+        for (auto i = config.constBegin(); i != config.constEnd(); ++i) {
+            QHash<QByteArray, Result> &executables = policy[i.key().toUtf8()];
+            QJsonObject object = i.value().toObject();
+            for (auto j = object.constBegin(); j != object.constEnd(); ++j) {
+                QString v = j.value().toString();
+                if (v == QStringLiteral("deny")) {
+                    executables.insert(j.key().toUtf8(), Result::Deny);
+                } else if (v == QStringLiteral("allow")) {
+                    executables.insert(j.key().toUtf8(), Result::Allow);
+                }
+            }
         }
+        return policy;
+    }
 
-        config = config.value(global).toObject();
-        QJsonValue value = config.value(executable);
-        if (value != QJsonValue::Undefined) {
-            QString v = value.toString();
-            if (v == QStringLiteral("deny")) {
-                return Result::Deny;
-            } else if (v == QStringLiteral("allow")) {
-                return Result::Allow;
+    void watchPolicies()
+    {
+        watcher = new Orbital::PolicyWatcher(policyFiles);
+        if (!watcher->isValid()) {
+            qWarning("The policy files will be read at every request.");
+            delete watcher;
+            watcher = nullptr;
+        }
+    }
+
+    void policiesChanged()
+    {
+        if (watcher->readEvents()) {
+            qDebug("Policy files changed, reloading them.");
+            if (!watcher->addWatches()) {
+                qWarning("The policy files will be read at every request.");
+                delete watcher;
+                watcher = nullptr;
             }
+            loadPolicies();
         }
-        return Result::Unknown;
     }
 
     wl_display *display;
     wl_registry *registry;
     orbital_authorizer_helper *helper;
+    QStringList policyFiles;
+    QVector<Policy> policies;
+    Orbital::PolicyWatcher *watcher;
 };
 
 int main(int argc, char **argv)
 {
     Helper helper;
+    helper.loadPolicies();
+    helper.watchPolicies();
 
     helper.display = wl_display_connect(nullptr);
 
@@ -168,9 +221,32 @@ int main(int argc, char **argv)
         exit(1);
     }
 
-    int ret = 0;
-    while (ret != -1)
-        ret = wl_display_dispatch(helper.display);
+    pollfd fds[2] = {
+        { wl_display_get_fd(helper.display), POLLIN, 0 },
+        { helper.watcher ? helper.watcher->fd() : -1, POLLIN, 0 }
+    };
+    while (true) {
+        if (wl_display_flush(helper.display) < 0 && errno != EAGAIN) {
+            break;
+        }
+        if (poll(fds, helper.watcher ? 2 : 1, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        // Reload the policies before handling the requests, the compositor
+        // may be asking again because it noticed the change too.
+        if (helper.watcher && fds[1].revents & POLLIN) {
+            helper.policiesChanged();
+        }
+        if (fds[0].revents & (POLLIN | POLLERR | POLLHUP)) {
+            if (wl_display_dispatch(helper.display) == -1) {
+                break;
+            }
+        }
+    }
 
     return 0;
 }
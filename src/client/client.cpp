@@ -44,7 +44,9 @@
 
 #include "client.h"
 #include "iconimageprovider.h"
+#include "wallpaperimageprovider.h"
 #include "window.h"
+#include "windowmodel.h"
 #include "shellui.h"
 #include "element.h"
 #include "grab.h"
@@ -53,9 +55,11 @@
 #include "uiscreen.h"
 #include "style.h"
 #include "notification.h"
+#include "wakeupscheduler.h"
 #include "compositorsettings.h"
 #include "activeregion.h"
 #include "clipboard.h"
+#include "clipboardhistory.h"
 
 Client *Client::s_client = nullptr;
 
@@ -68,6 +72,31 @@ public:
     uint32_t serial;
 };
 
+// Lets the elements be incubated a few milliseconds per frame
+class IncubationController : public QObject, public QQmlIncubationController
+{
+public:
+    IncubationController(QObject *p) : QObject(p), m_timer(0) {}
+
+protected:
+    void incubatingObjectCountChanged(int count) override
+    {
+        if (count && !m_timer) {
+            m_timer = startTimer(16);
+        } else if (!count && m_timer) {
+            killTimer(m_timer);
+            m_timer = 0;
+        }
+    }
+    void timerEvent(QTimerEvent *) override
+    {
+        incubateFor(5);
+    }
+
+private:
+    int m_timer;
+};
+
 class ClientPrivate {
     Q_DECLARE_PUBLIC(Client)
 public:
@@ -97,7 +126,9 @@ Client::Client()
       : QObject()
       , m_notifications(nullptr)
       , m_settings(nullptr)
+      , m_clipboard(nullptr)
       , m_ui(nullptr)
+      , m_windows(new WindowModel(this))
       , d_ptr(new ClientPrivate(this))
 {
     s_client = this;
@@ -126,6 +157,7 @@ Client::Client()
     qmlRegisterUncreatableType<StyleInfo>("Orbital", 1, 0, "StyleInfo", QStringLiteral("StyleInfo is not creatable"));
     qmlRegisterUncreatableType<UiScreen>("Orbital", 1, 0, "UiScreen", QStringLiteral("UiScreen is not creatable"));
     qmlRegisterUncreatableType<Clipboard>("Orbital", 1, 0, "Clipboard", QStringLiteral("Clipboard is only available via attached properties"));
+    qmlRegisterType<ClipboardHistory>("Orbital", 1, 0, "ClipboardHistory");
 
     qRegisterMetaType<QScreen *>();
 
@@ -152,8 +184,11 @@ Client::Client()
     Style::loadStylesList();
 
     m_engine = new QQmlEngine(this);
+    m_engine->setIncubationController(new IncubationController(m_engine));
     m_engine->rootContext()->setContextProperty(QStringLiteral("Client"), this);
+    m_engine->rootContext()->setContextProperty(QStringLiteral("WakeupScheduler"), WakeupScheduler::instance());
     m_engine->addImageProvider(QStringLiteral("icon"), new IconImageProvider);
+    m_engine->addImageProvider(QStringLiteral("wallpaper"), new WallpaperImageProvider);
     m_engine->addImportPath(QStringLiteral(LIBRARIES_PATH "/qml"));
 
     // TODO: find a way to un-hardcode this
@@ -171,6 +206,7 @@ Client::~Client()
     delete m_grabWindow;
     delete m_ui;
     delete m_settings;
+    delete m_clipboard;
     qDeleteAll(m_workspaces);
 
     Element::cleanupElementsList();
@@ -236,9 +272,11 @@ void Client::loadOutput(QScreen *s, const QString &name, uint32_t serial)
         m_ui = new ShellUI(this, m_settings, m_engine, configFile);
     }
     UiScreen *screen = m_ui->loadScreen(s, name);
-    qDebug() << "Elements for screen" << name << "loaded after" << m_elapsedTimer.elapsed() << "ms";
 
-    connect(screen, &UiScreen::loaded, [this, serial]() { sendOutputLoaded(serial); });
+    connect(screen, &UiScreen::loaded, [this, name, serial]() {
+        qDebug() << "Elements for screen" << name << "loaded after" << m_elapsedTimer.elapsed() << "ms";
+        sendOutputLoaded(serial);
+    });
 }
 
 void Client::sendOutputLoaded(uint32_t serial)
@@ -293,7 +331,7 @@ void Client::setLockScreen(QQuickWindow *window, QScreen *screen)
 
 void Client::windowDestroyed(Window *w)
 {
-    m_windows.removeOne(w);
+    m_windows->removeWindow(w);
     emit windowsChanged();
     emit windowRemoved(w);
 }
@@ -301,13 +339,13 @@ void Client::windowDestroyed(Window *w)
 int ClientPrivate::windowsCount(QQmlListProperty<Window> *prop)
 {
     Client *c = static_cast<Client *>(prop->object);
-    return c->m_windows.count();
+    return c->m_windows->windows().count();
 }
 
 Window *ClientPrivate::windowsAt(QQmlListProperty<Window> *prop, int index)
 {
     Client *c = static_cast<Client *>(prop->object);
-    return c->m_windows.at(index);
+    return c->m_windows->windows().at(index);
 }
 
 QQmlListProperty<Window> ClientPrivate::windows()
@@ -480,7 +518,12 @@ void Client::handleGlobal(wl_registry *registry, uint32_t id, const char *interf
     } else if (strcmp(interface, "wl_subcompositor") == 0) {
         m_subcompositor = static_cast<wl_subcompositor *>(wl_registry_bind(registry, id, &wl_subcompositor_interface, 1));
     } else if (strcmp(interface, "orbital_clipboard_manager") == 0) {
-        wl_registry_bind(registry, id, &orbital_clipboard_manager_interface, 1);
+        if (version >= 2) {
+            m_clipboard = new ClipboardManager(static_cast<orbital_clipboard_manager *>(wl_registry_bind(registry, id, &orbital_clipboard_manager_interface, 2)));
+            m_clipboard->moveToThread(QCoreApplication::instance()->thread());
+        } else {
+            wl_registry_bind(registry, id, &orbital_clipboard_manager_interface, 1);
+        }
     }
 }
 
@@ -564,11 +607,16 @@ void Client::setGrabCursor()
 void Client::handleWindowAdded(desktop_shell *desktop_shell, desktop_shell_window *window, uint32_t pid)
 {
     Window *w = new Window(window, pid);
-
-    m_windows << w;
     w->moveToThread(QCoreApplication::instance()->thread());
 
+    // The model must only change in the gui thread
+    QMetaObject::invokeMethod(this, "addWindow", Q_ARG(Window *, w));
+}
+
+void Client::addWindow(Window *w)
+{
     connect(w, &Window::destroyed, this, &Client::windowDestroyed);
+    m_windows->addWindow(w);
 
     emit windowsChanged();
     emit windowAdded(w);
@@ -640,6 +688,18 @@ QQuickWindow *Client::window(Element *elm)
     return window;
 }
 
+bool Client::sharedRenderLoop()
+{
+    static const bool shared = qEnvironmentVariableIsSet("ORBITAL_SHARED_RENDER_LOOP");
+    return shared;
+}
+
+bool Client::renderStats()
+{
+    static const bool stats = qEnvironmentVariableIsSet("ORBITAL_RENDER_STATS");
+    return stats;
+}
+
 void Client::addUiWindow(QQuickWindow *window)
 {
     m_uiWindows << window;
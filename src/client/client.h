@@ -60,6 +60,8 @@ class StyleInfo;
 class Element;
 class CompositorSettings;
 class UiScreen;
+class ClipboardManager;
+class WindowModel;
 
 class Binding : public QObject
 {
@@ -79,6 +81,7 @@ class Client : public QObject
 {
     Q_OBJECT
     Q_PRIVATE_PROPERTY(Client::d_func(), QQmlListProperty<Window> windows READ windows NOTIFY windowsChanged)
+    Q_PROPERTY(WindowModel *windowModel READ windowModel CONSTANT)
     Q_PRIVATE_PROPERTY(Client::d_func(), QQmlListProperty<Workspace> workspaces READ workspaces NOTIFY workspacesChanged)
     Q_PRIVATE_PROPERTY(Client::d_func(), QQmlListProperty<ElementInfo> elementsInfo READ elementsInfo NOTIFY elementsInfoChanged)
     Q_PRIVATE_PROPERTY(Client::d_func(), QQmlListProperty<StyleInfo> stylesInfo READ stylesInfo NOTIFY stylesInfoChanged)
@@ -100,9 +103,13 @@ public:
     static QQuickWindow *createUiWindow();
     QQuickWindow *window(Element *ele);
     QQmlEngine *qmlEngine() const { return m_engine; }
+    WindowModel *windowModel() const { return m_windows; }
 
     static Client *client() { return s_client; }
     static QLocale locale();
+    static bool sharedRenderLoop();
+    // Whether the screens report their buffer memory and render time, in either render loop mode
+    static bool renderStats();
 
     void setBackground(QQuickWindow *window, QScreen *screen);
     desktop_shell_panel *setPanel(QQuickWindow *window, QScreen *screen, int location);
@@ -140,6 +147,7 @@ signals:
 
 private slots:
     void create();
+    void addWindow(Window *w);
     void windowDestroyed(Window *w);
     void setGrabCursor();
     void sendOutputLoaded(uint32_t serial);
@@ -171,6 +179,7 @@ private:
     notifications_manager *m_notifications;
     wl_subcompositor *m_subcompositor;
     CompositorSettings *m_settings;
+    ClipboardManager *m_clipboard;
     QQmlEngine *m_engine;
     QWindow *m_grabWindow;
     QList<Binding *> m_bindings;
@@ -178,7 +187,7 @@ private:
     QElapsedTimer m_elapsedTimer;
     ShellUI *m_ui;
 
-    QList<Window *> m_windows;
+    WindowModel *m_windows;
     QList<Workspace *> m_workspaces;
     QHash<QByteArray, std::function<void ()>> m_actions;
 
@@ -17,21 +17,171 @@
  * along with Orbital.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+
 #include <QClipboard>
 #include <QGuiApplication>
+#include <QMimeData>
+#include <QSocketNotifier>
 #include <QDebug>
 
 #include "clipboard.h"
+#include "utils.h"
+
+#include "wayland-clipboard-client-protocol.h"
+
+// Text bigger than this is not worth showing in the shell.
+static const int MaxTextSize = 4 * 1024 * 1024;
+
+ClipboardManager *ClipboardManager::s_instance = nullptr;
+
+ClipboardManager::ClipboardManager(orbital_clipboard_manager *manager)
+                : QObject()
+                , m_manager(manager)
+                , m_serial(0)
+                , m_textSerial(0)
+                , m_fetchingText(false)
+{
+    static const orbital_clipboard_manager_listener listener = {
+        wrapInterface(&ClipboardManager::handleOffer),
+        wrapInterface(&ClipboardManager::handleSelection)
+    };
+    orbital_clipboard_manager_add_listener(m_manager, &listener, this);
+
+    s_instance = this;
+}
+
+ClipboardManager::~ClipboardManager()
+{
+    orbital_clipboard_manager_destroy(m_manager);
+    s_instance = nullptr;
+}
+
+void ClipboardManager::handleOffer(orbital_clipboard_manager *manager, const char *mimeType)
+{
+    m_pendingMimeTypes << QString::fromUtf8(mimeType);
+}
+
+void ClipboardManager::handleSelection(orbital_clipboard_manager *manager, uint32_t serial)
+{
+    QMetaObject::invokeMethod(this, "setSelection", Qt::QueuedConnection, Q_ARG(uint32_t, serial), Q_ARG(QStringList, m_pendingMimeTypes));
+    m_pendingMimeTypes.clear();
+}
+
+void ClipboardManager::setSelection(uint32_t serial, const QStringList &mimeTypes)
+{
+    m_serial = serial;
+    m_mimeTypes = mimeTypes;
+    m_text = QString();
+
+    // Only the mime types are known at this point, the data is transferred
+    // when somebody asks for it.
+    emit selectionChanged();
+    emit textChanged();
+}
+
+QString ClipboardManager::textMimeType() const
+{
+    static const char *const types[] = { "text/plain;charset=utf-8", "UTF8_STRING", "text/plain" };
+    for (const char *type: types) {
+        if (m_mimeTypes.contains(QLatin1String(type))) {
+            return QLatin1String(type);
+        }
+    }
+    return QString();
+}
+
+bool ClipboardManager::hasText() const
+{
+    return !textMimeType().isEmpty();
+}
+
+QString ClipboardManager::text()
+{
+    if (m_textSerial == m_serial) {
+        return m_text;
+    }
+
+    QString mimeType = textMimeType();
+    if (!mimeType.isEmpty() && !m_fetchingText) {
+        m_fetchingText = true;
+        uint32_t serial = m_serial;
+        fetch(mimeType, MaxTextSize, [this, serial](const QByteArray &data) {
+            m_fetchingText = false;
+            if (serial == m_serial) {
+                m_text = QString::fromUtf8(data);
+                m_textSerial = serial;
+                emit textChanged();
+            } else {
+                // the selection changed while we were reading, try again
+                emit textChanged();
+            }
+        });
+    }
+    return QString();
+}
+
+void ClipboardManager::fetch(const QString &mimeType, int maxSize, const std::function<void (const QByteArray &data)> &callback)
+{
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) == -1) {
+        qWarning("Failed to create a pipe for the selection: %s", strerror(errno));
+        callback(QByteArray());
+        return;
+    }
+    fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+
+    orbital_clipboard_manager_receive(m_manager, m_serial, qPrintable(mimeType), fds[1]);
+    close(fds[1]);
+
+    QSocketNotifier *notifier = new QSocketNotifier(fds[0], QSocketNotifier::Read, this);
+    QByteArray *data = new QByteArray;
+    connect(notifier, &QSocketNotifier::activated, [notifier, data, maxSize, callback](int fd) {
+        char buf[65536];
+        ssize_t n;
+        while ((n = read(fd, buf, sizeof(buf))) > 0) {
+            data->append(buf, n);
+            if (data->size() > maxSize) {
+                qWarning("Selection data is bigger than %d bytes, discarding it.", maxSize);
+                data->clear();
+                n = 0;
+                break;
+            }
+        }
+        if (n == -1 && (errno == EAGAIN || errno == EINTR)) {
+            return;
+        }
+
+        notifier->setEnabled(false);
+        notifier->deleteLater();
+        close(fd);
+        callback(*data);
+        delete data;
+    });
+}
+
 
 Clipboard::Clipboard(QObject *p)
          : QObject(p)
 {
-    QClipboard *clipboard = QGuiApplication::clipboard();
-    connect(clipboard, &QClipboard::dataChanged, this, &Clipboard::textChanged);
+    if (ClipboardManager *manager = ClipboardManager::instance()) {
+        connect(manager, &ClipboardManager::textChanged, this, &Clipboard::textChanged);
+        connect(manager, &ClipboardManager::selectionChanged, this, &Clipboard::selectionChanged);
+    } else {
+        QClipboard *clipboard = QGuiApplication::clipboard();
+        connect(clipboard, &QClipboard::dataChanged, this, &Clipboard::textChanged);
+        connect(clipboard, &QClipboard::dataChanged, this, &Clipboard::selectionChanged);
+    }
 }
 
 QString Clipboard::text() const
 {
+    if (ClipboardManager *manager = ClipboardManager::instance()) {
+        return manager->text();
+    }
     return QGuiApplication::clipboard()->text();
 }
 
@@ -40,6 +190,24 @@ void Clipboard::setText(const QString &text)
     QGuiApplication::clipboard()->setText(text);
 }
 
+bool Clipboard::hasText() const
+{
+    if (ClipboardManager *manager = ClipboardManager::instance()) {
+        return manager->hasText();
+    }
+    const QMimeData *data = QGuiApplication::clipboard()->mimeData();
+    return data && data->hasText();
+}
+
+QStringList Clipboard::mimeTypes() const
+{
+    if (ClipboardManager *manager = ClipboardManager::instance()) {
+        return manager->mimeTypes();
+    }
+    const QMimeData *data = QGuiApplication::clipboard()->mimeData();
+    return data ? data->formats() : QStringList();
+}
+
 Clipboard *Clipboard::qmlAttachedProperties(QObject *obj)
 {
     return new Clipboard(obj);
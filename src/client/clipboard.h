@@ -20,23 +20,72 @@
 #ifndef ORBITAL_CLIPBOARD_H
 #define ORBITAL_CLIPBOARD_H
 
+#include <functional>
+
 #include <QObject>
+#include <QStringList>
 #include <QtQml>
 
+struct orbital_clipboard_manager;
+
+class ClipboardManager : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ClipboardManager(orbital_clipboard_manager *manager);
+    ~ClipboardManager();
+
+    static ClipboardManager *instance() { return s_instance; }
+
+    QStringList mimeTypes() const { return m_mimeTypes; }
+    bool hasText() const;
+    QString text();
+
+    void fetch(const QString &mimeType, int maxSize, const std::function<void (const QByteArray &data)> &callback);
+
+signals:
+    void selectionChanged();
+    void textChanged();
+
+private slots:
+    void setSelection(uint32_t serial, const QStringList &mimeTypes);
+
+private:
+    void handleOffer(orbital_clipboard_manager *manager, const char *mimeType);
+    void handleSelection(orbital_clipboard_manager *manager, uint32_t serial);
+    QString textMimeType() const;
+
+    orbital_clipboard_manager *m_manager;
+    QStringList m_pendingMimeTypes;
+    QStringList m_mimeTypes;
+    uint32_t m_serial;
+    QString m_text;
+    uint32_t m_textSerial;
+    bool m_fetchingText;
+
+    static ClipboardManager *s_instance;
+};
+
 class Clipboard : public QObject
 {
     Q_OBJECT
     Q_PROPERTY(QString text READ text WRITE setText NOTIFY textChanged)
+    Q_PROPERTY(bool hasText READ hasText NOTIFY selectionChanged)
+    Q_PROPERTY(QStringList mimeTypes READ mimeTypes NOTIFY selectionChanged)
 public:
     Clipboard(QObject *p = nullptr);
 
     QString text() const;
     void setText(const QString &text);
 
+    bool hasText() const;
+    QStringList mimeTypes() const;
+
     static Clipboard *qmlAttachedProperties(QObject *object);
 
 signals:
     void textChanged();
+    void selectionChanged();
 
 };
 
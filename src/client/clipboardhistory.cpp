@@ -0,0 +1,250 @@
+/*
+ * Copyright 2015 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This file is part of Orbital
+ *
+ * Orbital is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Orbital is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Orbital.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QClipboard>
+#include <QMimeData>
+#include <QGuiApplication>
+#include <QCryptographicHash>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QFile>
+#include <QDir>
+#include <QDebug>
+
+#include "clipboardhistory.h"
+#include "clipboard.h"
+
+ClipboardHistory::ClipboardHistory(QObject *parent)
+                : QAbstractListModel(parent)
+                , m_maximumEntries(15)
+                , m_memoryLimit(1024 * 1024)
+                , m_memoryUsage(0)
+                , m_diskCache(false)
+                , m_cacheDir(nullptr)
+{
+    if (ClipboardManager *manager = ClipboardManager::instance()) {
+        connect(manager, &ClipboardManager::textChanged, this, &ClipboardHistory::textChanged);
+    } else {
+        connect(QGuiApplication::clipboard(), &QClipboard::dataChanged, this, &ClipboardHistory::textChanged);
+    }
+}
+
+ClipboardHistory::~ClipboardHistory()
+{
+    delete m_cacheDir;
+}
+
+void ClipboardHistory::setMaximumEntries(int entries)
+{
+    if (m_maximumEntries == entries) {
+        return;
+    }
+    m_maximumEntries = entries;
+    trim();
+    emit maximumEntriesChanged();
+}
+
+void ClipboardHistory::setMemoryLimit(int limit)
+{
+    if (m_memoryLimit == limit) {
+        return;
+    }
+    m_memoryLimit = limit;
+    trim();
+    emit memoryLimitChanged();
+}
+
+void ClipboardHistory::setDiskCache(bool cache)
+{
+    if (m_diskCache == cache) {
+        return;
+    }
+    m_diskCache = cache;
+    emit diskCacheChanged();
+}
+
+int ClipboardHistory::rowCount(const QModelIndex &parent) const
+{
+    return m_entries.count();
+}
+
+QVariant ClipboardHistory::data(const QModelIndex &index, int role) const
+{
+    if (index.row() < 0 || index.row() >= m_entries.count()) {
+        return QVariant();
+    }
+
+    switch (role) {
+        case Qt::DisplayRole:
+        case TextRole:
+            return text(index.row());
+        case SizeRole:
+            return m_entries.at(index.row()).size;
+        default:
+            break;
+    }
+    return QVariant();
+}
+
+QHash<int, QByteArray> ClipboardHistory::roleNames() const
+{
+    QHash<int, QByteArray> roles;
+    roles.insert(TextRole, "text");
+    roles.insert(SizeRole, "size");
+    return roles;
+}
+
+QString ClipboardHistory::text(int index) const
+{
+    if (index < 0 || index >= m_entries.count()) {
+        return QString();
+    }
+
+    const Entry &e = m_entries.at(index);
+    if (e.cacheFile.isEmpty()) {
+        return QString::fromUtf8(e.data);
+    }
+
+    QFile file(e.cacheFile);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning("Cannot read the clipboard cache file %s.", qPrintable(e.cacheFile));
+        return QString();
+    }
+    return QString::fromUtf8(file.readAll());
+}
+
+void ClipboardHistory::activate(int index)
+{
+    QString t = text(index);
+    if (!t.isEmpty()) {
+        QGuiApplication::clipboard()->setText(t);
+    }
+}
+
+void ClipboardHistory::textChanged()
+{
+    // Password managers mark the secrets they copy, never write those to disk
+    static const QString passwordHint = QStringLiteral("x-kde-passwordManagerHint");
+
+    QString text;
+    bool sensitive;
+    if (ClipboardManager *manager = ClipboardManager::instance()) {
+        text = manager->text();
+        sensitive = manager->mimeTypes().contains(passwordHint);
+    } else {
+        const QMimeData *mime = QGuiApplication::clipboard()->mimeData();
+        text = QGuiApplication::clipboard()->text();
+        sensitive = mime && mime->hasFormat(passwordHint);
+    }
+
+    if (!text.isEmpty()) {
+        add(text.toUtf8(), sensitive);
+    }
+}
+
+void ClipboardHistory::add(const QByteArray &data, bool sensitive)
+{
+    QByteArray hash = QCryptographicHash::hash(data, QCryptographicHash::Sha1);
+    if (!m_entries.isEmpty() && m_entries.first().hash == hash) {
+        return;
+    }
+
+    for (int i = 1; i < m_entries.count(); ++i) {
+        if (m_entries.at(i).hash == hash) {
+            beginMoveRows(QModelIndex(), i, i, QModelIndex(), 0);
+            m_entries.move(i, 0);
+            endMoveRows();
+            return;
+        }
+    }
+
+    beginInsertRows(QModelIndex(), 0, 0);
+    m_entries.prepend({ hash, data, data.size(), sensitive, QString() });
+    m_memoryUsage += data.size();
+    endInsertRows();
+    emit countChanged();
+
+    trim();
+}
+
+void ClipboardHistory::remove(int index)
+{
+    beginRemoveRows(QModelIndex(), index, index);
+    Entry e = m_entries.takeAt(index);
+    if (e.cacheFile.isEmpty()) {
+        m_memoryUsage -= e.size;
+    } else {
+        QFile::remove(e.cacheFile);
+    }
+    endRemoveRows();
+    emit countChanged();
+}
+
+void ClipboardHistory::trim()
+{
+    while (m_entries.count() > qMax(m_maximumEntries, 0)) {
+        remove(m_entries.count() - 1);
+    }
+
+    // Evict the biggest entries first, a single huge selection should not
+    // push out a lot of small ones.
+    while (m_memoryUsage > m_memoryLimit) {
+        int biggest = -1;
+        for (int i = 0; i < m_entries.count(); ++i) {
+            const Entry &e = m_entries.at(i);
+            if (e.cacheFile.isEmpty() && (biggest < 0 || e.size > m_entries.at(biggest).size)) {
+                biggest = i;
+            }
+        }
+        if (biggest < 0) {
+            break;
+        }
+
+        Entry &e = m_entries[biggest];
+        if (m_diskCache && !e.sensitive && spill(e)) {
+            m_memoryUsage -= e.size;
+            e.data = QByteArray();
+        } else {
+            remove(biggest);
+        }
+    }
+}
+
+bool ClipboardHistory::spill(Entry &entry)
+{
+    if (!m_cacheDir) {
+        QString path = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + QStringLiteral("/orbital");
+        QDir().mkpath(path);
+        m_cacheDir = new QTemporaryDir(path + QStringLiteral("/clipboard-XXXXXX"));
+    }
+    if (!m_cacheDir->isValid()) {
+        return false;
+    }
+
+    QString path = m_cacheDir->path() + QLatin1Char('/') + QString::fromLatin1(entry.hash.toHex());
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(entry.data) != entry.data.size()) {
+        qWarning("Cannot write the clipboard cache file %s.", qPrintable(path));
+        file.remove();
+        return false;
+    }
+
+    entry.cacheFile = path;
+    return true;
+}
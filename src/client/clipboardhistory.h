@@ -0,0 +1,88 @@
+/*
+ * Copyright 2015 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This file is part of Orbital
+ *
+ * Orbital is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Orbital is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Orbital.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ORBITAL_CLIPBOARDHISTORY_H
+#define ORBITAL_CLIPBOARDHISTORY_H
+
+#include <QAbstractListModel>
+
+class QTemporaryDir;
+
+class ClipboardHistory : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(int maximumEntries READ maximumEntries WRITE setMaximumEntries NOTIFY maximumEntriesChanged)
+    Q_PROPERTY(int memoryLimit READ memoryLimit WRITE setMemoryLimit NOTIFY memoryLimitChanged)
+    Q_PROPERTY(bool diskCache READ diskCache WRITE setDiskCache NOTIFY diskCacheChanged)
+    Q_PROPERTY(int count READ rowCount NOTIFY countChanged)
+public:
+    enum Roles {
+        TextRole = Qt::UserRole + 1,
+        SizeRole
+    };
+
+    explicit ClipboardHistory(QObject *parent = nullptr);
+    ~ClipboardHistory();
+
+    int maximumEntries() const { return m_maximumEntries; }
+    void setMaximumEntries(int entries);
+
+    int memoryLimit() const { return m_memoryLimit; }
+    void setMemoryLimit(int limit);
+
+    bool diskCache() const { return m_diskCache; }
+    void setDiskCache(bool cache);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    Q_INVOKABLE QString text(int index) const;
+    Q_INVOKABLE void activate(int index);
+
+signals:
+    void maximumEntriesChanged();
+    void memoryLimitChanged();
+    void diskCacheChanged();
+    void countChanged();
+
+private:
+    struct Entry {
+        QByteArray hash;
+        QByteArray data;
+        int size;
+        bool sensitive;
+        QString cacheFile;
+    };
+
+    void textChanged();
+    void add(const QByteArray &data, bool sensitive);
+    void remove(int index);
+    void trim();
+    bool spill(Entry &entry);
+
+    QList<Entry> m_entries;
+    int m_maximumEntries;
+    int m_memoryLimit;
+    int m_memoryUsage;
+    bool m_diskCache;
+    QTemporaryDir *m_cacheDir;
+};
+
+#endif
@@ -58,6 +58,9 @@ Element::Element(Element *parent)
 
 Element::~Element()
 {
+    foreach (StyleItem *item, m_styleItems) {
+        item->m_element = nullptr;
+    }
     if (m_parent) {
         m_parent->m_children.removeOne(this);
     }
@@ -128,44 +131,32 @@ void Element::setInputRegion(const QRectF &rect)
 {
     m_inputRegion = rect;
     m_inputRegionSet = true;
-    if (window() && window()->handle()) {
+    // Don't touch the region of a window shared with other elements
+    if (window() && window()->handle() && window()->property("element").value<Element *>() == this) {
         Client::client()->setInputRegion(window(), rect);
     }
     emit inputRegionChanged();
 }
 
-static void traverse(QObject *object, Element::Location l)
-{
-    for (QObject *o: object->children()) {
-        if (StyleItem *s = qobject_cast<StyleItem *>(o)) {
-            s->updateLocation(l);
-        }
-        traverse(o, l);
-    }
-}
-static void traverse(QQuickItem *object, Element::Location l)
-{
-    foreach (QQuickItem *o, object->childItems()) {
-        if (StyleItem *s = qobject_cast<StyleItem *>(o)) {
-            s->updateLocation(l);
-        }
-        traverse(o, l);
-    }
-    traverse(static_cast<QObject *>(object), l);
-}
-
 void Element::setLocation(Location p)
 {
     if (m_location != p) {
         m_location = p;
         emit locationChanged();
+        updateStyleItems();
 
         foreach (Element *elm, m_children) {
             elm->m_location = p;
             emit elm->locationChanged();
+            elm->updateStyleItems();
         }
+    }
+}
 
-        traverse(this, m_location);
+void Element::updateStyleItems()
+{
+    foreach (StyleItem *item, m_styleItems) {
+        item->updateLocation(m_location);
     }
 }
 
@@ -380,26 +371,56 @@ void Element::settingsVisibleChanged(bool visible)
     }
 }
 
+QQmlComponent *Element::component(QQmlEngine *engine, const QString &name, bool synchronous)
+{
+    ElementInfo *info = s_elements.value(name);
+    if (!info) {
+        qWarning() << QStringLiteral("Could not find the element \'%1\'. Check your configuration or your setup.").arg(name);
+        return nullptr;
+    }
+
+    QQmlComponent::CompilationMode mode = synchronous ? QQmlComponent::PreferSynchronous : QQmlComponent::Asynchronous;
+    if (!info->m_component) {
+        info->m_component = new QQmlComponent(engine, engine);
+        info->m_component->loadUrl(info->m_qml, mode);
+    } else if (synchronous && info->m_component->isLoading()) {
+        // The type loader waits for the compilation already in progress
+        // instead of starting a new one
+        info->m_component->loadUrl(info->m_qml, mode);
+    }
+    return info->m_component;
+}
+
+void Element::setup(ShellUI *shell, UiScreen *screen, const QString &name, int id)
+{
+    if (id < 0) {
+        m_id = s_id++;
+    } else {
+        setId(id);
+    }
+    m_typeName = name;
+    m_shell = shell;
+    m_info = s_elements.value(name);
+    m_screen = nullptr;
+    screen->addElement(this);
+}
+
 Element *Element::create(ShellUI *shell, UiScreen *screen, QQmlEngine *engine, const QString &name, int id)
 {
     QElapsedTimer timer;
     timer.start();
 
-    if (!s_elements.contains(name)) {
-        qWarning() << QStringLiteral("Could not find the element \'%1\'. Check your configuration or your setup.").arg(name);
+    QQmlComponent *c = Element::component(engine, name, true);
+    if (!c) {
         return nullptr;
     }
-
-    ElementInfo *info = s_elements.value(name);
-    QQmlComponent c(engine);
-    c.loadUrl(info->m_qml);
-    if (!c.isReady()) {
+    if (!c->isReady()) {
         qWarning() << "Could not load the element" << name;
-        qWarning() << qPrintable(c.errorString());
+        qWarning() << qPrintable(c->errorString());
         return nullptr;
     }
 
-    QObject *obj = c.beginCreate(engine->rootContext());
+    QObject *obj = c->beginCreate(engine->rootContext());
     Element *elm = qobject_cast<Element *>(obj);
     if (!elm) {
         qWarning() << QStringLiteral("\'%1\' is not an element type.").arg(name);
@@ -407,18 +428,8 @@ Element *Element::create(ShellUI *shell, UiScreen *screen, QQmlEngine *engine, c
         return nullptr;
     }
 
-    if (id < 0) {
-        elm->m_id = s_id++;
-    } else {
-        elm->setId(id);
-    }
-    elm->m_typeName = name;
-    elm->m_shell = shell;
-    elm->m_info = info;
-    elm->m_screen = nullptr;
-    screen->addElement(elm);
-
-    c.completeCreate();
+    elm->setup(shell, screen, name, id);
+    c->completeCreate();
 
     qDebug() <<"Creating" << name << "in" << timer.elapsed() << "ms.";
 
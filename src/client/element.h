@@ -22,14 +22,17 @@
 
 #include <QQuickItem>
 #include <QStringList>
+#include <QPointer>
 
 class QQmlEngine;
+class QQmlComponent;
 class QQuickWindow;
 
 struct wl_surface;
 
 class LayoutAttached;
 class ElementConfig;
+class StyleItem;
 class ShellUI;
 class UiScreen;
 
@@ -59,6 +62,7 @@ private:
     QString m_path;
     QString m_qml;
     Type m_type;
+    QPointer<QQmlComponent> m_component;
 
     friend class Element;
 };
@@ -148,6 +152,8 @@ public:
     static void cleanupElementsList();
     static const QMap<QString, ElementInfo *> &elementsInfo() { return s_elements; }
     static Element *create(ShellUI *shell, UiScreen *screen, QQmlEngine *engine, const QString &name, int id = -1);
+    // The component is loaded asynchronously, unless synchronous is true, and shared by all the instances
+    static QQmlComponent *component(QQmlEngine *engine, const QString &name, bool synchronous = false);
 
     Q_INVOKABLE void publish(const QPointF &offset = QPointF());
     Q_INVOKABLE void closeSettings();
@@ -178,6 +184,8 @@ private:
     void createConfig(Element *child);
     void createBackground(Element *child);
     void settingsVisibleChanged(bool visible);
+    void setup(ShellUI *shell, UiScreen *screen, const QString &name, int id);
+    void updateStyleItems();
 
     static void loadElementInfo(const QString &name, const QString &path);
 
@@ -202,6 +210,7 @@ private:
     QRectF m_inputRegion;
     bool m_inputRegionSet;
     Location m_location;
+    QList<StyleItem *> m_styleItems;
 
     QQmlComponent *m_childrenBackground;
     QQuickItem *m_background;
@@ -215,6 +224,7 @@ private:
     static QMap<QString, ElementInfo *> s_elements;
 
     friend class UiScreen;
+    friend class StyleItem;
 };
 
 class ElementConfig : public QQuickItem
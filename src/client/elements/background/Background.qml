@@ -161,7 +161,9 @@ Element {
 
         Image {
             id: image
-            source: bkg.imageSource
+            // The wallpaper service decodes the image once at the screen's size
+            source: bkg.imageSource.length > 0 ? "image://wallpaper/" + fillMode + "/" + encodeURIComponent(bkg.imageSource) : ""
+            sourceSize: Qt.size(bkg.width * Screen.devicePixelRatio, bkg.height * Screen.devicePixelRatio)
             fillMode: bkg.fillModes[bkg.imageFillMode].value
             anchors.fill: parent
             smooth: true
@@ -293,7 +295,7 @@ Element {
                             }
                         }
 
-                        model: browser.dirContent
+                        model: browser
                         orientation: ListView.Horizontal
 
                         delegate: Rectangle {
@@ -314,15 +316,15 @@ Element {
                                     sourceSize: Qt.size(width, height)
                                     fillMode: Image.PreserveAspectFit
                                     asynchronous: true
-                                    cache: modelData.isDir()
+                                    cache: model.isDir
 
-                                    source: modelData.isDir() ? "image://icon/folder" : modelData.path()
+                                    source: model.isDir ? "image://icon/" + model.icon : model.path
                                 }
                                 Text {
                                     anchors.top: thumb.bottom
                                     width: parent.width
                                     horizontalAlignment: Text.AlignHCenter
-                                    text: modelData.name
+                                    text: model.name
                                     color: "white"
                                     elide: Text.ElideMiddle
                                 }
@@ -349,10 +351,10 @@ Element {
                                 onExited: glow.opacity = 0
 
                                 onClicked: {
-                                    if (modelData.isDir()) {
-                                        browser.cd(modelData.name);
+                                    if (model.isDir) {
+                                        browser.cd(model.name);
                                     } else {
-                                        bkg.imageSource = modelData.path();
+                                        bkg.imageSource = model.path;
                                     }
                                 }
                             }
@@ -33,7 +33,10 @@ PopupElement {
     Layout.preferredHeight: 30
     minimumWidth: 40
     minimumHeight: 40
-    property int selectionActive: -1
+    property int selectionActive: Clipboard.hasText && historyModel.count > 0 ? 0 : -1
+    property int historyLength: 15
+    property int historyMemoryLimit: 1024
+    property bool historyDiskCache: false
 
     buttonContent: Icon {
         id: icon
@@ -44,41 +47,18 @@ PopupElement {
 
     }
 
-    Clipboard.onTextChanged: {
-        var curr = historyModel.count > 0 ? historyModel.get(0).text : ""
-        var text = Clipboard.text;
-        if (!text) {
-            selectionActive = -1;
-            return;
-        }
-        selectionActive = 0;
-        if (text == curr) {
-            return;
-        }
-
-        for (var i = 0; i < historyModel.count; ++i) {
-            if (historyModel.get(i).text == text) {
-                historyModel.remove(i);
-                break;
-            }
-        }
-
-        historyModel.insert(0, { "text": text });
-        if (historyModel.count > 15) {
-            historyModel.remove(14);
-        }
-    }
-
     function activate(index) {
         if (index == selectionActive) {
             return;
         }
-        var text = historyModel.get(index).text;
-        Clipboard.text = text
+        historyModel.activate(index);
     }
 
-    ListModel {
+    ClipboardHistory {
         id: historyModel
+        maximumEntries: root.historyLength
+        memoryLimit: root.historyMemoryLimit * 1024
+        diskCache: root.historyDiskCache
     }
 
     popupWidth: 300
@@ -162,7 +142,7 @@ PopupElement {
                     x: 2
                     y: 2
                     width: parent.width - 4
-                    text: modelData
+                    text: model.text
                     elide: Text.ElideRight
                     wrapMode: Text.WrapAnywhere
                     color: CurrentStyle.textColor
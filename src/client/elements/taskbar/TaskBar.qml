@@ -33,34 +33,6 @@ Element {
     width: Layout.preferredWidth
     height: Layout.preferredHeight
 
-    ListModel {
-        id: windowsModel
-
-    }
-
-    Component.onCompleted: {
-        var windows = Client.windows;
-        for (var i = 0; i < windows.length; ++i) {
-            var d = windows[i];
-            windowsModel.append({ "window": windows[i] });
-        }
-    }
-
-    Connections {
-        target: Client
-        onWindowAdded: {
-            windowsModel.append({ "window": window });
-        }
-        onWindowRemoved: {
-            for (var i = 0; i < windowsModel.count; ++i) {
-                if (windowsModel.get(i).window == window) {
-                    windowsModel.remove(i);
-                    return;
-                }
-            }
-        }
-    }
-
     contentItem: StyleItem {
         anchors.fill: parent
         component: CurrentStyle.taskBarBackground
@@ -71,10 +43,10 @@ Element {
             orientation: taskbar.orientation
 
             Repeater {
-                model: windowsModel
+                model: Client.windowModel
 
                 TaskBarItem {
-                    window: modelData
+                    window: model.window
                     screen: taskbar.screen
 
                     Behavior on x { PropertyAnimation { } }
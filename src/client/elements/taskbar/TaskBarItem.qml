@@ -38,6 +38,8 @@ Item {
     Mpris {
         id: mpris
         pid: window.pid
+        // the progress bar is 200 pixels at most, once per second is plenty
+        positionUpdateInterval: valid ? 1000 : 0
 
         onValidChanged: {
             if (valid) {
@@ -17,37 +17,120 @@
  * along with Orbital.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <algorithm>
+
 #include <QtQml>
+#include <QDirIterator>
+#include <QThreadPool>
+#include <QSocketNotifier>
+#include <QMimeDatabase>
 
 #include <filebrowser.h>
 
 static const int a = qmlRegisterType<FileBrowser>("Orbital", 1, 0, "FileBrowser");
-static const int b = qmlRegisterType<FileInfo>();
 
-FileInfo::FileInfo(const QString &path)
-        : m_info(path)
-{
-}
+// The listing is handed to the model in chunks of this many entries, so that
+// a huge directory never stalls the gui thread on a single insertion
+static const int BatchSize = 512;
 
-QString FileInfo::name() const
+static bool lessThan(const FileBrowser::Entry &a, const FileBrowser::Entry &b)
 {
-    return m_info.fileName();
+    return a.name.compare(b.name, Qt::CaseInsensitive) < 0;
 }
 
-bool FileInfo::isDir() const
+struct FileBrowser::Job
 {
-    return m_info.isDir();
-}
+    QMutex mutex;
+    bool cancelled = false;
+};
 
-QString FileInfo::path() const
+class ListingJob : public QRunnable
 {
-    return m_info.filePath();
-}
+public:
+    ListingJob(FileBrowser *browser, const QSharedPointer<FileBrowser::Job> &job, int generation, const QString &path, const QStringList &filters)
+        : m_browser(browser)
+        , m_job(job)
+        , m_generation(generation)
+        , m_path(path)
+        , m_filters(filters)
+    {
+    }
+
+    void run() override
+    {
+        QDir dir(m_path);
+        dir.setNameFilters(m_filters);
+        dir.setFilter(QDir::AllDirs | QDir::Files | QDir::NoDotAndDotDot);
+
+        FileBrowser::Entries entries;
+        QDirIterator it(dir);
+        while (it.hasNext()) {
+            it.next();
+            entries << FileBrowser::Entry{ it.fileName(), it.fileInfo().isDir(), QString() };
+
+            if (entries.count() % BatchSize == 0 && isCancelled()) {
+                return;
+            }
+        }
+        std::sort(entries.begin(), entries.end(), lessThan);
+
+        int i = 0;
+        do {
+            if (!post(entries.mid(i, BatchSize), i + BatchSize >= entries.count())) {
+                return;
+            }
+            i += BatchSize;
+        } while (i < entries.count());
+    }
+
+private:
+    bool isCancelled()
+    {
+        QMutexLocker locker(&m_job->mutex);
+        return m_job->cancelled;
+    }
+
+    bool post(const FileBrowser::Entries &entries, bool last)
+    {
+        // Hold the lock while posting, so the browser cannot go away in between.
+        // Once it is deleted the events queued for it are discarded.
+        QMutexLocker locker(&m_job->mutex);
+        if (m_job->cancelled) {
+            return false;
+        }
+        QMetaObject::invokeMethod(m_browser, "addEntries", Qt::QueuedConnection, Q_ARG(int, m_generation),
+                                  Q_ARG(FileBrowser::Entries, entries), Q_ARG(bool, last));
+        return true;
+    }
+
+    FileBrowser *m_browser;
+    QSharedPointer<FileBrowser::Job> m_job;
+    int m_generation;
+    QString m_path;
+    QStringList m_filters;
+};
 
 
 FileBrowser::FileBrowser(QObject *p)
-           : QObject(p)
+           : QAbstractListModel(p)
+           , m_generation(0)
+           , m_inotify(-1)
+           , m_watch(-1)
+           , m_notifier(nullptr)
 {
+    qRegisterMetaType<FileBrowser::Entries>();
+}
+
+FileBrowser::~FileBrowser()
+{
+    cancel();
+    if (m_inotify >= 0) {
+        close(m_inotify);
+    }
 }
 
 void FileBrowser::setPath(const QString &path)
@@ -68,21 +151,31 @@ void FileBrowser::setPath(const QString &path)
 
 void FileBrowser::setNameFilters(const QStringList &filters)
 {
+    if (m_dir.nameFilters() == filters) {
+        return;
+    }
+
     m_dir.setNameFilters(filters);
+    // Don't list the working directory if the filters are set before the path
+    if (m_generation > 0) {
+        rebuildFilesList();
+    }
 }
 
 void FileBrowser::cdUp()
 {
-    m_dir.cdUp();
-    rebuildFilesList();
-    emit pathChanged();
+    if (m_dir.cdUp()) {
+        rebuildFilesList();
+        emit pathChanged();
+    }
 }
 
 void FileBrowser::cd(const QString &dir)
 {
-    m_dir.cd(dir);
-    rebuildFilesList();
-    emit pathChanged();
+    if (m_dir.cd(dir)) {
+        rebuildFilesList();
+        emit pathChanged();
+    }
 }
 
 void FileBrowser::cdHome()
@@ -100,31 +193,188 @@ QStringList FileBrowser::nameFilters() const
     return m_dir.nameFilters();
 }
 
-int FileBrowser::filesCount(QQmlListProperty<FileInfo> *prop)
+bool FileBrowser::loading() const
 {
-    FileBrowser *c = static_cast<FileBrowser *>(prop->object);
-    return c->m_files.count();
+    return !m_job.isNull();
 }
 
-FileInfo *FileBrowser::fileAt(QQmlListProperty<FileInfo> *prop, int index)
+int FileBrowser::rowCount(const QModelIndex &parent) const
 {
-    FileBrowser *c = static_cast<FileBrowser *>(prop->object);
-    return c->m_files.at(index);
+    return parent.isValid() ? 0 : m_files.count();
 }
 
-QQmlListProperty<FileInfo> FileBrowser::dirContent()
+QVariant FileBrowser::data(const QModelIndex &index, int role) const
 {
-    return QQmlListProperty<FileInfo>(this, 0, filesCount, fileAt);
+    if (!index.isValid() || index.row() >= m_files.count()) {
+        return QVariant();
+    }
+
+    const Entry &entry = m_files.at(index.row());
+    switch (role) {
+        case NameRole:
+            return entry.name;
+        case PathRole:
+            return m_dir.filePath(entry.name);
+        case IsDirRole:
+            return entry.isDir;
+        case IconRole:
+            // Only the delegates actually created ask for this, so the mime lookup
+            // is done just for the visible rows, and then remembered
+            if (entry.icon.isEmpty()) {
+                entry.icon = entry.isDir ? QStringLiteral("folder") :
+                             QMimeDatabase().mimeTypeForFile(m_dir.filePath(entry.name), QMimeDatabase::MatchExtension).iconName();
+            }
+            return entry.icon;
+    }
+    return QVariant();
+}
+
+QHash<int, QByteArray> FileBrowser::roleNames() const
+{
+    QHash<int, QByteArray> roles;
+    roles.insert(NameRole, "name");
+    roles.insert(PathRole, "path");
+    roles.insert(IsDirRole, "isDir");
+    roles.insert(IconRole, "icon");
+    return roles;
 }
 
 void FileBrowser::rebuildFilesList()
 {
-    foreach (FileInfo *f, m_files) {
-        f->deleteLater();
-    }
+    cancel();
+
+    beginResetModel();
     m_files.clear();
-    QStringList files = m_dir.entryList(QDir::AllDirs | QDir::Files | QDir::NoDotAndDotDot);
-    foreach (const QString &s, files) {
-        m_files << new FileInfo(m_dir.filePath(s));
+    endResetModel();
+    emit countChanged();
+
+    // Start watching before listing, the events arriving in the meantime are
+    // queued and applied on top of the listing when it is complete
+    watch();
+
+    m_job = QSharedPointer<Job>::create();
+    QThreadPool::globalInstance()->start(new ListingJob(this, m_job, ++m_generation, m_dir.absolutePath(), m_dir.nameFilters()));
+    emit loadingChanged();
+}
+
+void FileBrowser::cancel()
+{
+    if (m_job) {
+        QMutexLocker locker(&m_job->mutex);
+        m_job->cancelled = true;
+    }
+    m_job.clear();
+    m_pendingEvents.clear();
+}
+
+void FileBrowser::addEntries(int generation, const FileBrowser::Entries &entries, bool last)
+{
+    if (generation != m_generation) {
+        return;
+    }
+
+    if (!entries.isEmpty()) {
+        beginInsertRows(QModelIndex(), m_files.count(), m_files.count() + entries.count() - 1);
+        m_files += entries;
+        endInsertRows();
+        emit countChanged();
+    }
+
+    if (last) {
+        m_job.clear();
+        foreach (const Event &event, m_pendingEvents) {
+            applyEvent(event);
+        }
+        m_pendingEvents.clear();
+        emit loadingChanged();
+    }
+}
+
+void FileBrowser::watch()
+{
+    if (m_inotify < 0) {
+        m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (m_inotify < 0) {
+            qWarning("FileBrowser: cannot initialize inotify: %s", strerror(errno));
+            return;
+        }
+        m_notifier = new QSocketNotifier(m_inotify, QSocketNotifier::Read, this);
+        connect(m_notifier, &QSocketNotifier::activated, this, &FileBrowser::readEvents);
+    }
+
+    if (m_watch >= 0) {
+        inotify_rm_watch(m_inotify, m_watch);
+    }
+    m_watch = inotify_add_watch(m_inotify, qPrintable(QFile::encodeName(m_dir.absolutePath())),
+                                IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR);
+}
+
+void FileBrowser::readEvents()
+{
+    char buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    ssize_t len;
+    while ((len = read(m_inotify, buf, sizeof(buf))) > 0) {
+        for (char *ptr = buf; ptr < buf + len; ) {
+            const inotify_event *ev = reinterpret_cast<const inotify_event *>(ptr);
+            ptr += sizeof(inotify_event) + ev->len;
+
+            // Events for a directory we watched before may still be in the queue
+            if (ev->wd != m_watch || ev->len == 0) {
+                continue;
+            }
+
+            Event event = { QFile::decodeName(ev->name), bool(ev->mask & (IN_CREATE | IN_MOVED_TO)) };
+            if (m_job) {
+                m_pendingEvents << event;
+            } else {
+                applyEvent(event);
+            }
+        }
+    }
+}
+
+void FileBrowser::applyEvent(const Event &event)
+{
+    bool found;
+    int row = find(event.name, &found);
+
+    if (event.created) {
+        if (found || event.name.startsWith(QLatin1Char('.'))) {
+            return;
+        }
+        // The file may be already gone again, we'll get the deletion event too
+        QFileInfo info(m_dir.filePath(event.name));
+        if (!info.exists()) {
+            return;
+        }
+        bool isDir = info.isDir();
+        if (!isDir && !m_dir.nameFilters().isEmpty() && !QDir::match(m_dir.nameFilters(), event.name)) {
+            return;
+        }
+
+        beginInsertRows(QModelIndex(), row, row);
+        m_files.insert(row, Entry{ event.name, isDir, QString() });
+        endInsertRows();
+        emit countChanged();
+    } else if (found) {
+        beginRemoveRows(QModelIndex(), row, row);
+        m_files.remove(row);
+        endRemoveRows();
+        emit countChanged();
+    }
+}
+
+int FileBrowser::find(const QString &name, bool *found) const
+{
+    Entry key = { name, false, QString() };
+    auto begin = std::lower_bound(m_files.begin(), m_files.end(), key, lessThan);
+    // Names differing only by case sort together, look for the exact one among them
+    for (auto it = begin; it != m_files.end() && !lessThan(key, *it); ++it) {
+        if (it->name == name) {
+            *found = true;
+            return it - m_files.begin();
+        }
     }
+    *found = false;
+    return begin - m_files.begin();
 }
@@ -20,43 +20,49 @@
 #ifndef FILEBROWSER_H
 #define FILEBROWSER_H
 
-#include <QObject>
+#include <QAbstractListModel>
 #include <QDir>
+#include <QVector>
+#include <QSharedPointer>
 
-class FileInfo : public QObject
-{
-    Q_OBJECT
-    Q_PROPERTY(QString name READ name NOTIFY nameChanged)
-public:
-    FileInfo(const QString &file);
-
-    QString name() const;
-
-    Q_INVOKABLE bool isDir() const;
-    Q_INVOKABLE QString path() const;
-
-signals:
-    void nameChanged();
-
-private:
-    QFileInfo m_info;
-};
+class QSocketNotifier;
 
-class FileBrowser : public QObject
+class FileBrowser : public QAbstractListModel
 {
     Q_OBJECT
     Q_PROPERTY(QString path READ path WRITE setPath NOTIFY pathChanged)
     Q_PROPERTY(QStringList nameFilters READ nameFilters WRITE setNameFilters)
-    Q_PROPERTY(QQmlListProperty<FileInfo> dirContent READ dirContent NOTIFY pathChanged)
+    Q_PROPERTY(int count READ rowCount NOTIFY countChanged)
+    Q_PROPERTY(bool loading READ loading NOTIFY loadingChanged)
 public:
+    enum Roles {
+        NameRole = Qt::UserRole + 1,
+        PathRole,
+        IsDirRole,
+        IconRole
+    };
+
+    struct Entry {
+        QString name;
+        bool isDir;
+        mutable QString icon;
+    };
+    typedef QVector<Entry> Entries;
+    struct Job;
+
     FileBrowser(QObject *p = nullptr);
+    ~FileBrowser();
 
     void setPath(const QString &path);
     void setNameFilters(const QStringList &filters);
 
     QString path() const;
     QStringList nameFilters() const;
-    QQmlListProperty<FileInfo> dirContent();
+    bool loading() const;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role) const override;
+    QHash<int, QByteArray> roleNames() const override;
 
 public slots:
     void cdUp();
@@ -65,14 +71,35 @@ public slots:
 
 signals:
     void pathChanged();
+    void countChanged();
+    void loadingChanged();
+
+private slots:
+    void addEntries(int generation, const FileBrowser::Entries &entries, bool last);
+    void readEvents();
 
 private:
+    struct Event {
+        QString name;
+        bool created;
+    };
+
     void rebuildFilesList();
-    static int filesCount(QQmlListProperty<FileInfo> *prop);
-    static FileInfo *fileAt(QQmlListProperty<FileInfo> *prop, int index);
+    void cancel();
+    void watch();
+    void applyEvent(const Event &event);
+    int find(const QString &name, bool *found) const;
 
     QDir m_dir;
-    QList<FileInfo *> m_files;
+    Entries m_files;
+    QSharedPointer<Job> m_job;
+    int m_generation;
+    int m_inotify;
+    int m_watch;
+    QSocketNotifier *m_notifier;
+    QList<Event> m_pendingEvents;
 };
 
+Q_DECLARE_METATYPE(FileBrowser::Entries)
+
 #endif
@@ -19,24 +19,241 @@
 
 #include <QIcon>
 #include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QImageReader>
+
+#include <memory>
 
 #include "iconimageprovider.h"
+#include "icontheme.h"
+#include "imagecache.h"
+
+// The in memory cache holds this many bytes of ARGB32 images
+static const int MemoryCacheSize = 8 * 1024 * 1024;
+
+class IconImageResponse : public QQuickImageResponse, public QRunnable
+{
+public:
+    IconImageResponse(IconImageProvider *provider, const QString &id, const QSize &size)
+        : m_provider(provider)
+        , m_id(id)
+        , m_size(size)
+    {
+        setAutoDelete(false);
+    }
+
+    // Reads the disk cache, or decodes the icon file and saves it there
+    void run() override;
+
+    void done(const QImage &image)
+    {
+        m_image = image;
+        emit finished();
+    }
+
+    QQuickTextureFactory *textureFactory() const override
+    {
+        return QQuickTextureFactory::textureFactoryForImage(m_image);
+    }
+
+private:
+    QImage decode() const;
+
+    IconImageProvider *m_provider;
+    QString m_id;
+    QSize m_size;
+    QString m_key;
+    QString m_file;
+    QString m_path;
+    QImage m_image;
+
+    friend class IconThemeResolver;
+};
+
+// QIcon may only be used in the GUI thread, so the theme name and the search
+// paths are read here, and the icon files are found here too. Reading them
+// is left to the pool.
+class IconThemeResolver : public QObject
+{
+    Q_OBJECT
+public:
+    IconThemeResolver(IconImageProvider *provider)
+        : QObject()
+        , m_provider(provider)
+    {
+    }
+
+    Q_INVOKABLE void lookup(QObject *object)
+    {
+        IconImageResponse *response = static_cast<IconImageResponse *>(object);
+
+        QString theme = QIcon::themeName();
+        const QSize &size = response->m_size;
+        response->m_key = QStringLiteral("%1\n%2\n%3x%4").arg(theme, response->m_id).arg(size.width()).arg(size.height());
+        QImage image = m_provider->find(response->m_key);
+        if (!image.isNull()) {
+            response->done(image);
+            return;
+        }
+
+        QStringList searchPaths = QIcon::themeSearchPaths();
+        if (!m_theme || m_theme->name() != theme || m_theme->searchPaths() != searchPaths) {
+            m_theme.reset(new IconTheme(theme, searchPaths));
+        }
+        int iconSize = qMax(size.width(), size.height());
+        response->m_file = m_theme->lookup(response->m_id, iconSize);
+        if (response->m_file.isEmpty()) {
+            response->m_file = m_theme->lookup(QStringLiteral("image-missing"), iconSize);
+        }
+
+        QString dir = m_provider->cacheDir(theme);
+        if (!dir.isEmpty()) {
+            response->m_path = dir + '/' + QString::fromLatin1(QCryptographicHash::hash(response->m_key.toUtf8(), QCryptographicHash::Sha1).toHex());
+        }
+        m_provider->m_pool.start(response);
+    }
+
+private:
+    IconImageProvider *m_provider;
+    std::unique_ptr<IconTheme> m_theme;
+};
+
+void IconImageResponse::run()
+{
+    QImage image;
+    if (!m_path.isEmpty()) {
+        image = ImageCache::load(m_path);
+        if (!image.isNull()) {
+            m_provider->insert(m_key, image, &m_provider->m_diskHits);
+            done(image);
+            return;
+        }
+    }
+
+    image = decode();
+    m_provider->insert(m_key, image, nullptr);
+    // this may be deleted as soon as it is done, take a copy of the path
+    QString path = m_path;
+    done(image);
+    if (!path.isEmpty() && !image.isNull()) {
+        ImageCache::save(path, image);
+    }
+}
+
+QImage IconImageResponse::decode() const
+{
+    if (m_file.isEmpty()) {
+        return QImage();
+    }
+
+    // Like QIcon, scale down to fit but only scale up the scalable icons
+    QImageReader reader(m_file);
+    QSize size = reader.size();
+    if (size.isValid() && (IconTheme::isScalable(m_file) || size.width() > m_size.width() || size.height() > m_size.height())) {
+        reader.setScaledSize(size.scaled(m_size, Qt::KeepAspectRatio));
+    }
+    QImage image = reader.read();
+    if (image.isNull()) {
+        qWarning() << "Cannot read the icon" << m_file << ":" << reader.errorString();
+    }
+    return image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+}
 
 IconImageProvider::IconImageProvider()
-                 : QQuickImageProvider(QQuickImageProvider::Pixmap)
+                 : QQuickAsyncImageProvider()
+                 , m_resolver(new IconThemeResolver(this))
+                 , m_memoryCache(MemoryCacheSize)
+{
+    // Decoding the svg icons is the expensive part, don't starve the other threads though
+    m_pool.setMaxThreadCount(2);
+}
+
+IconImageProvider::~IconImageProvider()
 {
+    m_pool.waitForDone();
+    delete m_resolver;
+    qDebug("Icon cache: %d requests, %d memory hits, %d disk hits.", m_requests.load(), m_memoryHits.load(), m_diskHits.load());
 }
 
-QPixmap IconImageProvider::requestPixmap(const QString &id, QSize *realSize, const QSize &requestedSize)
+QQuickImageResponse *IconImageProvider::requestImageResponse(const QString &id, const QSize &requestedSize)
 {
     QSize size(requestedSize);
     if (size.width() < 1) size.setWidth(1);
     if (size.height() < 1) size.setHeight(1);
-    QIcon icon = QIcon::fromTheme(id);
-    if (icon.isNull()) {
-        icon = QIcon::fromTheme(QStringLiteral("image-missing"));
+
+    // This runs in the pixmap reader thread, the lookup needs the GUI thread
+    IconImageResponse *response = new IconImageResponse(this, id, size);
+    QMetaObject::invokeMethod(m_resolver, "lookup", Qt::QueuedConnection, Q_ARG(QObject *, response));
+    return response;
+}
+
+void IconImageProvider::countRequest(QAtomicInt *counter)
+{
+    if (counter) {
+        counter->ref();
+    }
+    int requests = m_requests.fetchAndAddRelaxed(1) + 1;
+    if (requests % 500 == 0) {
+        qDebug("Icon cache: %d requests, %.1f%% memory hits, %.1f%% disk hits.", requests,
+               m_memoryHits.load() * 100. / requests, m_diskHits.load() * 100. / requests);
+    }
+}
+
+QImage IconImageProvider::find(const QString &key)
+{
+    QMutexLocker locker(&m_mutex);
+    if (QImage *image = m_memoryCache.object(key)) {
+        countRequest(&m_memoryHits);
+        return *image;
     }
-    *realSize = size;
+    return QImage();
+}
 
-    return icon.pixmap(size);
+void IconImageProvider::insert(const QString &key, const QImage &image, QAtomicInt *counter)
+{
+    QMutexLocker locker(&m_mutex);
+    m_memoryCache.insert(key, new QImage(image), image.byteCount());
+    countRequest(counter);
 }
+
+QString IconImageProvider::cacheDir(const QString &theme)
+{
+    auto it = m_cacheDirs.constFind(theme);
+    if (it != m_cacheDirs.constEnd()) {
+        return *it;
+    }
+
+    // The cache directory name contains the newest mtime of the theme directories,
+    // so a theme update makes us start with a new, empty cache.
+    qint64 stamp = 0;
+    QStringList themes = { theme, QStringLiteral("hicolor") };
+    foreach (const QString &searchPath, QIcon::themeSearchPaths()) {
+        foreach (const QString &t, themes) {
+            QFileInfo fi(searchPath + '/' + t);
+            if (fi.exists()) {
+                stamp = qMax(stamp, fi.lastModified().toMSecsSinceEpoch());
+            }
+        }
+    }
+
+    QDir root(QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + QStringLiteral("/orbital/icons"));
+    QString name = QStringLiteral("%1-%2").arg(theme).arg(stamp);
+    foreach (const QString &old, root.entryList({ theme + QStringLiteral("-*") }, QDir::Dirs | QDir::NoDotAndDotDot)) {
+        if (old != name) {
+            QDir(root.filePath(old)).removeRecursively();
+        }
+    }
+
+    QString dir;
+    if (root.mkpath(name)) {
+        dir = root.filePath(name);
+    }
+    m_cacheDirs.insert(theme, dir);
+    return dir;
+}
+
+#include "iconimageprovider.moc"
@@ -20,14 +20,40 @@
 #ifndef ICONIMAGEPROVIDER_H
 #define ICONIMAGEPROVIDER_H
 
-#include <QQuickImageProvider>
+#include <QQuickAsyncImageProvider>
+#include <QThreadPool>
+#include <QCache>
+#include <QMutex>
+#include <QHash>
+#include <QAtomicInt>
 
-class IconImageProvider : public QQuickImageProvider
+class IconThemeResolver;
+
+class IconImageProvider : public QQuickAsyncImageProvider
 {
 public:
     IconImageProvider();
+    ~IconImageProvider();
+
+    QQuickImageResponse *requestImageResponse(const QString &id, const QSize &requestedSize) override;
+
+private:
+    QImage find(const QString &key);
+    void insert(const QString &key, const QImage &image, QAtomicInt *counter);
+    QString cacheDir(const QString &theme);
+    void countRequest(QAtomicInt *counter);
+
+    QThreadPool m_pool;
+    IconThemeResolver *m_resolver;
+    QMutex m_mutex;
+    QCache<QString, QImage> m_memoryCache;
+    QHash<QString, QString> m_cacheDirs;
+    QAtomicInt m_requests;
+    QAtomicInt m_memoryHits;
+    QAtomicInt m_diskHits;
 
-    QPixmap requestPixmap(const QString &id, QSize *size, const QSize &requestedSize);
+    friend class IconImageResponse;
+    friend class IconThemeResolver;
 };
 
 #endif
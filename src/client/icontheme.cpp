@@ -0,0 +1,178 @@
+/*
+ * Copyright 2015 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This file is part of Orbital
+ *
+ * Orbital is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Orbital is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Orbital.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <limits.h>
+
+#include <QFile>
+#include <QSettings>
+
+#include "icontheme.h"
+
+static const char *extensions[] = { ".png", ".svg", ".xpm" };
+
+IconTheme::IconTheme(const QString &name, const QStringList &searchPaths)
+         : m_name(name)
+         , m_searchPaths(searchPaths)
+{
+}
+
+QString IconTheme::lookup(const QString &icon, int size)
+{
+    QString key = QStringLiteral("%1\n%2").arg(icon).arg(size);
+    auto it = m_files.constFind(key);
+    if (it != m_files.constEnd()) {
+        return *it;
+    }
+
+    // "audio-volume-high" falls back to "audio-volume", and then to "audio"
+    QString file;
+    QString name = icon;
+    while (file.isEmpty() && !name.isEmpty()) {
+        QStringList visited;
+        file = lookup(m_name, name, size, visited);
+        if (file.isEmpty() && !visited.contains(QStringLiteral("hicolor"))) {
+            file = lookup(QStringLiteral("hicolor"), name, size, visited);
+        }
+        int dash = name.lastIndexOf(QLatin1Char('-'));
+        name = dash > 0 ? name.left(dash) : QString();
+    }
+
+    if (file.isEmpty()) {
+        for (const char *ext: extensions) {
+            QString path = QStringLiteral("/usr/share/pixmaps/") + icon + QLatin1String(ext);
+            if (QFile::exists(path)) {
+                file = path;
+                break;
+            }
+        }
+    }
+
+    m_files.insert(key, file);
+    return file;
+}
+
+bool IconTheme::isScalable(const QString &file)
+{
+    return file.endsWith(QLatin1String(".svg")) || file.endsWith(QLatin1String(".svgz"));
+}
+
+const IconTheme::Theme &IconTheme::theme(const QString &name)
+{
+    auto it = m_themes.constFind(name);
+    if (it != m_themes.constEnd()) {
+        return *it;
+    }
+
+    Theme theme;
+    for (const QString &searchPath: m_searchPaths) {
+        QString base = searchPath + QLatin1Char('/') + name;
+        if (!QFile::exists(base)) {
+            continue;
+        }
+        theme.basePaths << base;
+
+        // The first index.theme found is the one that counts
+        QString index = base + QStringLiteral("/index.theme");
+        if (!theme.directories.isEmpty() || !QFile::exists(index)) {
+            continue;
+        }
+        QSettings settings(index, QSettings::IniFormat);
+        theme.inherits = settings.value(QStringLiteral("Icon Theme/Inherits")).toStringList();
+        foreach (const QString &path, settings.value(QStringLiteral("Icon Theme/Directories")).toStringList()) {
+            settings.beginGroup(path);
+            Directory dir;
+            dir.path = path;
+            dir.size = settings.value(QStringLiteral("Size")).toInt();
+            dir.minSize = settings.value(QStringLiteral("MinSize"), dir.size).toInt();
+            dir.maxSize = settings.value(QStringLiteral("MaxSize"), dir.size).toInt();
+            dir.threshold = settings.value(QStringLiteral("Threshold"), 2).toInt();
+            QString type = settings.value(QStringLiteral("Type")).toString();
+            dir.type = type == QStringLiteral("Fixed") ? Directory::Type::Fixed :
+                       type == QStringLiteral("Scalable") ? Directory::Type::Scalable : Directory::Type::Threshold;
+            settings.endGroup();
+            if (dir.size > 0) {
+                theme.directories << dir;
+            }
+        }
+    }
+    return *m_themes.insert(name, theme);
+}
+
+QString IconTheme::lookup(const QString &themeName, const QString &icon, int size, QStringList &visited)
+{
+    if (visited.contains(themeName)) {
+        return QString();
+    }
+    visited << themeName;
+
+    const Theme &t = theme(themeName);
+    QString best;
+    int bestDistance = INT_MAX;
+    for (const Directory &dir: t.directories) {
+        int d = distance(dir, size);
+        if (d >= bestDistance) {
+            continue;
+        }
+        for (int i = 0; i < t.basePaths.count() && bestDistance != d; ++i) {
+            for (const char *ext: extensions) {
+                QString file = t.basePaths.at(i) + QLatin1Char('/') + dir.path + QLatin1Char('/') + icon + QLatin1String(ext);
+                if (QFile::exists(file)) {
+                    best = file;
+                    bestDistance = d;
+                    break;
+                }
+            }
+        }
+        if (bestDistance == 0) {
+            break;
+        }
+    }
+    if (!best.isEmpty()) {
+        return best;
+    }
+
+    // copy them, looking up the parents may add to m_themes and invalidate t
+    const QStringList inherits = t.inherits;
+    for (const QString &parent: inherits) {
+        QString file = lookup(parent, icon, size, visited);
+        if (!file.isEmpty()) {
+            return file;
+        }
+    }
+    return QString();
+}
+
+int IconTheme::distance(const Directory &dir, int size)
+{
+    switch (dir.type) {
+        case Directory::Type::Fixed:
+            return qAbs(dir.size - size);
+        case Directory::Type::Scalable:
+            return size < dir.minSize ? dir.minSize - size : size > dir.maxSize ? size - dir.maxSize : 0;
+        case Directory::Type::Threshold:
+            break;
+    }
+    if (size < dir.size - dir.threshold) {
+        return dir.size - dir.threshold - size;
+    }
+    if (size > dir.size + dir.threshold) {
+        return size - dir.size - dir.threshold;
+    }
+    return 0;
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright 2015 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This file is part of Orbital
+ *
+ * Orbital is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Orbital is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Orbital.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ICONTHEME_H
+#define ICONTHEME_H
+
+#include <QHash>
+#include <QList>
+#include <QStringList>
+
+// Finds the icon files following the freedesktop icon theme specification.
+// Unlike QIcon it only deals with file names, so the files can then be read
+// in any thread with QImageReader.
+class IconTheme
+{
+public:
+    IconTheme(const QString &name, const QStringList &searchPaths);
+
+    QString name() const { return m_name; }
+    QStringList searchPaths() const { return m_searchPaths; }
+
+    // Returns the file best matching size, or an empty string
+    QString lookup(const QString &icon, int size);
+    // Whether the file is a scalable image, which can be rendered at any size
+    static bool isScalable(const QString &file);
+
+private:
+    struct Directory {
+        enum class Type { Fixed, Scalable, Threshold };
+        QString path;
+        Type type;
+        int size;
+        int minSize;
+        int maxSize;
+        int threshold;
+    };
+    struct Theme {
+        QStringList basePaths;
+        QList<Directory> directories;
+        QStringList inherits;
+    };
+
+    const Theme &theme(const QString &name);
+    QString lookup(const QString &themeName, const QString &icon, int size, QStringList &visited);
+    static int distance(const Directory &dir, int size);
+
+    QString m_name;
+    QStringList m_searchPaths;
+    QHash<QString, Theme> m_themes;
+    QHash<QString, QString> m_files;
+};
+
+#endif
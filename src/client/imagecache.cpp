@@ -0,0 +1,103 @@
+/*
+ * Copyright 2015 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This file is part of Orbital
+ *
+ * Orbital is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Orbital is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Orbital.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+
+#include "imagecache.h"
+
+static const quint32 CacheMagic = 0x4f524943; // "ORIC"
+
+struct CacheHeader {
+    quint32 magic;
+    quint32 width;
+    quint32 height;
+    quint32 bytesPerLine;
+};
+
+QImage ImageCache::load(const QString &path)
+{
+    int fd = open(QFile::encodeName(path).constData(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return QImage();
+    }
+
+    QImage image;
+    off_t len = lseek(fd, 0, SEEK_END);
+    if (len >= (off_t)sizeof(CacheHeader)) {
+        void *map = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            const CacheHeader *header = static_cast<const CacheHeader *>(map);
+            if (header->magic == CacheMagic &&
+                sizeof(CacheHeader) + (qint64)header->bytesPerLine * header->height == (quint64)len) {
+                struct Mapping { void *data; size_t len; };
+                Mapping *m = new Mapping{ map, (size_t)len };
+                // the image uses the mapped pixels as they are, and unmaps them when it goes away
+                image = QImage(static_cast<const uchar *>(map) + sizeof(CacheHeader), header->width, header->height,
+                               header->bytesPerLine, QImage::Format_ARGB32_Premultiplied, [](void *data) {
+                                   Mapping *m = static_cast<Mapping *>(data);
+                                   munmap(m->data, m->len);
+                                   delete m;
+                               }, m);
+            } else {
+                munmap(map, len);
+            }
+        }
+    }
+    close(fd);
+    return image;
+}
+
+void ImageCache::save(const QString &path, const QImage &image)
+{
+    CacheHeader header = { CacheMagic, (quint32)image.width(), (quint32)image.height(), (quint32)image.bytesPerLine() };
+
+    // QSaveFile writes to a temporary file and renames it, so readers never see a partial file
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return;
+    }
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(image.constBits()), image.byteCount());
+    file.commit();
+}
+
+void ImageCache::touch(const QString &path)
+{
+    utimensat(AT_FDCWD, QFile::encodeName(path).constData(), nullptr, 0);
+}
+
+void ImageCache::prune(const QString &dir, qint64 maxSize)
+{
+    // newest first
+    QFileInfoList files = QDir(dir).entryInfoList(QDir::Files | QDir::NoDotAndDotDot, QDir::Time);
+    qint64 size = 0;
+    for (const QFileInfo &fi: files) {
+        size += fi.size();
+        if (size > maxSize) {
+            QFile::remove(fi.absoluteFilePath());
+        }
+    }
+}
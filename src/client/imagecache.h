@@ -0,0 +1,38 @@
+/*
+ * Copyright 2015 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This file is part of Orbital
+ *
+ * Orbital is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Orbital is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Orbital.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IMAGECACHE_H
+#define IMAGECACHE_H
+
+#include <QImage>
+
+// Images saved to disk as a small header followed by the ARGB32 premultiplied
+// pixels, so that they can be mmap()ed and used directly as the image data.
+class ImageCache
+{
+public:
+    static QImage load(const QString &path);
+    static void save(const QString &path, const QImage &image);
+    // Marks the file as recently used, for prune()
+    static void touch(const QString &path);
+    // Deletes the least recently used files in dir until it is at most maxSize bytes
+    static void prune(const QString &dir, qint64 maxSize);
+};
+
+#endif
@@ -44,6 +44,9 @@ LayoutAttached::LayoutAttached(QObject *object)
 
 void LayoutAttached::setMinimumWidth(qreal width)
 {
+    if (m_minimumWidth == width) {
+        return;
+    }
     m_minimumWidth = width;
     invalidateItem();
     emit minimumWidthChanged();
@@ -51,6 +54,9 @@ void LayoutAttached::setMinimumWidth(qreal width)
 
 void LayoutAttached::setPreferredWidth(qreal width)
 {
+    if (m_preferredWidth == width) {
+        return;
+    }
     m_preferredWidth = width;
     invalidateItem();
     emit preferredWidthChanged();
@@ -58,6 +64,9 @@ void LayoutAttached::setPreferredWidth(qreal width)
 
 void LayoutAttached::setMaximumWidth(qreal width)
 {
+    if (m_maximumWidth == width) {
+        return;
+    }
     m_maximumWidth = width;
     invalidateItem();
     emit maximumWidthChanged();
@@ -65,6 +74,9 @@ void LayoutAttached::setMaximumWidth(qreal width)
 
 void LayoutAttached::setMinimumHeight(qreal height)
 {
+    if (m_minimumHeight == height) {
+        return;
+    }
     m_minimumHeight = height;
     invalidateItem();
     emit minimumHeightChanged();
@@ -72,6 +84,9 @@ void LayoutAttached::setMinimumHeight(qreal height)
 
 void LayoutAttached::setPreferredHeight(qreal height)
 {
+    if (m_preferredHeight == height) {
+        return;
+    }
     m_preferredHeight = height;
     invalidateItem();
     emit preferredHeightChanged();
@@ -79,6 +94,9 @@ void LayoutAttached::setPreferredHeight(qreal height)
 
 void LayoutAttached::setMaximumHeight(qreal height)
 {
+    if (m_maximumHeight == height) {
+        return;
+    }
     m_maximumHeight = height;
     invalidateItem();
     emit maximumHeightChanged();
@@ -86,6 +104,9 @@ void LayoutAttached::setMaximumHeight(qreal height)
 
 void LayoutAttached::setFillWidth(bool fill)
 {
+    if (m_fillWidth == fill) {
+        return;
+    }
     m_fillWidth = fill;
     invalidateItem();
     emit fillWidthChanged();
@@ -93,6 +114,9 @@ void LayoutAttached::setFillWidth(bool fill)
 
 void LayoutAttached::setFillHeight(bool fill)
 {
+    if (m_fillHeight == fill) {
+        return;
+    }
     m_fillHeight = fill;
     invalidateItem();
     emit fillHeightChanged();
@@ -157,22 +181,33 @@ bool Layout::event(QEvent *e)
 
 void Layout::geometryChanged(const QRectF &newGeometry, const QRectF &oldGeometry)
 {
-    invalidate();
+    // moving the layout doesn't move anything inside it
+    if (newGeometry.size() != oldGeometry.size()) {
+        invalidate();
+    }
+    QQuickItem::geometryChanged(newGeometry, oldGeometry);
 }
 
 void Layout::itemChange(ItemChange change, const ItemChangeData &value)
 {
     switch (change) {
-        case QQuickItem::ItemChildAddedChange:
-            m_items << value.item;
+        case QQuickItem::ItemChildAddedChange: {
+            LayoutAttached *la = attachedLayoutObject(value.item);
+            la->setOrientation(m_orientation);
+            m_items.append({ value.item, la });
+            updateIndices(m_items.count() - 1);
             connect(value.item, &QQuickItem::visibleChanged, this, &Layout::invalidate);
             invalidate();
-            break;
-        case QQuickItem::ItemChildRemovedChange:
-            m_items.removeOne(value.item);
+        } break;
+        case QQuickItem::ItemChildRemovedChange: {
+            int i = indexOf(value.item);
+            if (i >= 0) {
+                m_items.removeAt(i);
+                updateIndices(i);
+            }
             disconnect(value.item);
             invalidate();
-            break;
+        } break;
         default:
             break;
     }
@@ -180,18 +215,47 @@ void Layout::itemChange(ItemChange change, const ItemChangeData &value)
     QQuickItem::itemChange(change, value);
 }
 
+int Layout::indexOf(QQuickItem *item) const
+{
+    for (int i = 0; i < m_items.count(); ++i) {
+        if (m_items.at(i).item == item) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void Layout::move(QQuickItem *item, int index)
+{
+    int from = indexOf(item);
+    if (from < 0) {
+        return;
+    }
+    if (index < 0 || index >= m_items.count()) {
+        index = m_items.count() - 1;
+    }
+    if (from != index) {
+        m_items.move(from, index);
+        // only the items between the old and the new position changed index
+        updateIndices(qMin(from, index));
+        invalidate();
+    }
+}
+
+void Layout::updateIndices(int from)
+{
+    for (int i = from; i < m_items.count(); ++i) {
+        m_items.at(i).attached->m_index = i;
+    }
+}
+
 void Layout::insertAt(QQuickItem *item, int col)
 {
     if (item->parentItem() != this) {
         item->setParentItem(this);
     }
 
-    if (m_items.contains(item)) {
-        m_items.removeOne(item);
-    }
-    m_items.insert(col, item);
-
-    invalidate();
+    move(item, col);
 }
 
 void Layout::insertBefore(QQuickItem *item, QQuickItem *before)
@@ -200,17 +264,11 @@ void Layout::insertBefore(QQuickItem *item, QQuickItem *before)
         item->setParentItem(this);
     }
 
-    if (m_items.contains(item)) {
-        m_items.removeOne(item);
+    int from = indexOf(item);
+    int i = indexOf(before);
+    if (i >= 0) {
+        move(item, from < i ? i - 1 : i);
     }
-    for (int i = 0; i < m_items.size(); ++i) {
-        if (m_items.at(i) == before) {
-            m_items.insert(i, item);
-            break;
-        }
-    }
-
-    invalidate();
 }
 
 void Layout::insertAfter(QQuickItem *item, QQuickItem *after)
@@ -219,28 +277,15 @@ void Layout::insertAfter(QQuickItem *item, QQuickItem *after)
         item->setParentItem(this);
     }
 
-    if (m_items.contains(item)) {
-        m_items.removeOne(item);
+    int from = indexOf(item);
+    int i = indexOf(after);
+    if (i >= 0) {
+        move(item, from <= i ? i : i + 1);
     }
-    for (int i = 0; i < m_items.size(); ++i) {
-        if (m_items.at(i) == after) {
-            m_items.insert(i + 1, item);
-            break;
-        }
-    }
-
-    invalidate();
 }
 
 void Layout::invalidate()
 {
-    for (int i = 0; i < m_items.size(); ++i) {
-        QQuickItem *item = m_items.at(i);
-        LayoutAttached *la = attachedLayoutObject(item);
-        la->m_index = i;
-        la->setOrientation(m_orientation);
-    }
-
     if (m_dirty)
         return;
 
@@ -250,14 +295,19 @@ void Layout::invalidate()
 
 void Layout::setSpacing(qreal spacing)
 {
-    m_spacing = spacing;
-    invalidate();
+    if (spacing != m_spacing) {
+        m_spacing = spacing;
+        invalidate();
+    }
 }
 
 void Layout::setOrientation(Qt::Orientation orientation)
 {
     if (orientation != m_orientation) {
         m_orientation = orientation;
+        foreach (const Item &i, m_items) {
+            i.attached->setOrientation(m_orientation);
+        }
         invalidate();
     }
 }
@@ -273,13 +323,12 @@ void Layout::relayout()
         qreal x;
         qreal w;
     };
-    QList<It> _items;
-    foreach (QQuickItem *i, m_items) {
-        if (i->isVisible()) {
-            _items.append({ i, attachedLayoutObject(i), true, 0, 0 });
+    QVarLengthArray<It, 32> _items;
+    foreach (const Item &i, m_items) {
+        if (i.item->isVisible()) {
+            _items.append({ i.item, i.attached, true, 0, 0 });
         }
     }
-
     const bool horizontal = m_orientation == Qt::Horizontal;
     qreal x = 0;
     for (int j = 0; j < _items.count(); ++j) {
@@ -328,21 +377,19 @@ void Layout::relayout()
         }
     } while (again);
 
+    // The setters do nothing if the value doesn't change, so the items that
+    // stay where they are don't get any geometry change
     if (horizontal) {
         for (int j = 0; j < _items.count(); ++j) {
             It &i = _items[j];
-            i.item->setProperty("x", i.x);
-            i.item->setProperty("y", 0);
-            i.item->setProperty("width", i.w);
-            i.item->setProperty("height", height());
+            i.item->setPosition(QPointF(i.x, 0));
+            i.item->setSize(QSizeF(i.w, height()));
         }
     } else {
         for (int j = 0; j < _items.count(); ++j) {
             It &i = _items[j];
-            i.item->setProperty("y", i.x);
-            i.item->setProperty("x", 0);
-            i.item->setProperty("height", i.w);
-            i.item->setProperty("width", width());
+            i.item->setPosition(QPointF(0, i.x));
+            i.item->setSize(QSizeF(width(), i.w));
         }
     }
 }
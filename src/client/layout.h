@@ -52,7 +52,17 @@ protected:
     void geometryChanged(const QRectF &newGeometry, const QRectF &oldGeometry) override;
 
 private:
-    QList<QQuickItem *> m_items;
+    // The attached object of each child is looked up once, when it is added
+    struct Item {
+        QQuickItem *item;
+        LayoutAttached *attached;
+    };
+
+    int indexOf(QQuickItem *item) const;
+    void move(QQuickItem *item, int index);
+    void updateIndices(int from);
+
+    QList<Item> m_items;
     bool m_dirty;
     qreal m_spacing;
     Qt::Orientation m_orientation;
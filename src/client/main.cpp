@@ -23,8 +23,18 @@
 
 #include "client.h"
 
+#ifdef ORBITAL_ZYGOTE_MODULE
+extern "C" int orbital_zygote_main(int argc, char *argv[])
+#else
 int main(int argc, char *argv[])
+#endif
 {
+    // Render all the shell windows in the gui thread, one after the other, instead
+    // of spawning a render thread with its own timers for each of them
+    if (Client::sharedRenderLoop() && !qEnvironmentVariableIsSet("QSG_RENDER_LOOP")) {
+        setenv("QSG_RENDER_LOOP", "basic", 1);
+    }
+
     QApplication app(argc, argv);
     Client client;
 
@@ -19,27 +19,135 @@
 
 #include <QQuickWindow>
 #include <QQuickItem>
+#include <QTimer>
+#include <QDebug>
 
 #include "notification.h"
 #include "client.h"
 #include "wayland-desktop-shell-client-protocol.h"
 
+class WindowPool : public QObject
+{
+public:
+    WindowPool()
+        : size(4)
+        , prewarm(1)
+        , created(0)
+        , reused(0)
+    {
+        trimTimer.setSingleShot(true);
+        trimTimer.setInterval(60000);
+        connect(&trimTimer, &QTimer::timeout, [this]() { trim(prewarm); });
+    }
+    ~WindowPool()
+    {
+        qDeleteAll(windows);
+    }
+
+    QQuickWindow *createWindow()
+    {
+        QQuickWindow *window = new QQuickWindow;
+        window->setFlags(Qt::BypassWindowManagerHint);
+        window->setColor(Qt::transparent);
+        window->create();
+        created++;
+        return window;
+    }
+
+    QQuickWindow *take()
+    {
+        trimTimer.start();
+        if (windows.isEmpty()) {
+            return createWindow();
+        }
+        reused++;
+        return windows.takeLast();
+    }
+
+    void put(QQuickWindow *window)
+    {
+        window->hide();
+        if (windows.count() < size) {
+            windows << window;
+        } else {
+            delete window;
+        }
+        trimTimer.start();
+    }
+
+    void fill()
+    {
+        while (windows.count() < qMin(prewarm, size)) {
+            windows << createWindow();
+        }
+    }
+
+    void trim(int count)
+    {
+        if (windows.count() <= count) {
+            return;
+        }
+        while (windows.count() > count) {
+            delete windows.takeFirst();
+        }
+        qDebug("Notification windows: %d created, %d reused.", created, reused);
+    }
+
+    QList<QQuickWindow *> windows;
+    QTimer trimTimer;
+    int size;
+    int prewarm;
+    int created;
+    int reused;
+};
+
+static WindowPool *pool()
+{
+    static WindowPool *pool = new WindowPool;
+    return pool;
+}
+
 NotificationWindow::NotificationWindow(QObject *p)
                   : QObject(p)
-                  , m_window(new QQuickWindow)
+                  , m_window(pool()->take())
                   , m_contentItem(nullptr)
                   , m_inactive(false)
                   , m_surface(nullptr)
 {
-    m_window->setFlags(Qt::BypassWindowManagerHint);
-    m_window->setColor(Qt::transparent);
-    m_window->create();
 }
 
 NotificationWindow::~NotificationWindow()
 {
-    notification_surface_destroy(m_surface);
-    delete m_window;
+    if (m_surface) {
+        notification_surface_destroy(m_surface);
+    }
+    // the content item is deleted later with the rest of our children, the window goes
+    // back to the pool and must not keep it
+    if (m_contentItem) {
+        disconnect(m_contentItem, nullptr, this, nullptr);
+        m_contentItem->setParentItem(nullptr);
+    }
+    pool()->put(m_window);
+}
+
+void NotificationWindow::configurePool(int poolSize, int prewarm, int idleTimeout)
+{
+    WindowPool *p = pool();
+    p->size = qMax(0, poolSize);
+    p->prewarm = qMax(0, prewarm);
+    p->trimTimer.setInterval(idleTimeout);
+    p->trim(p->size);
+    p->fill();
+}
+
+int NotificationWindow::createdWindows()
+{
+    return pool()->created;
+}
+
+int NotificationWindow::reusedWindows()
+{
+    return pool()->reused;
 }
 
 QQuickItem *NotificationWindow::contentItem() const
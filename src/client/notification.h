@@ -42,6 +42,13 @@ public:
     bool inactive() const;
     void setInactive(bool inactive);
 
+    // Windows are expensive to create, so they are kept in a pool and reused.
+    // At most poolSize windows are kept, prewarm of them are created in advance
+    // and the pool shrinks back to prewarm after idleTimeout ms without notifications.
+    static void configurePool(int poolSize, int prewarm, int idleTimeout);
+    static int createdWindows();
+    static int reusedWindows();
+
 private:
     void resetWidth();
     void resetHeight();
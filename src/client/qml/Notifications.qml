@@ -30,10 +30,15 @@ Item {
             id: notif
             inactive: true
             property QtObject notification
-            property alias summary: summaryText.text
-            property alias body: bodyText.text
             property alias icon: image.source
 
+            // copy the texts, the notification object goes away before the fade out ends
+            function update() {
+                summaryText.text = notification.count > 1 ? "%1 (%2)".arg(notification.summary).arg(notification.count) : notification.summary;
+                bodyText.text = notification.body;
+            }
+            Component.onCompleted: update()
+
             StyleItem {
                 id: content
                 component: CurrentStyle.notificationBackground
@@ -47,6 +52,8 @@ Item {
                     width: 32
                     height: 32
                     fillMode: Image.PreserveAspectFit
+                    // the url stays the same when the notification is replaced
+                    cache: false
                     anchors.left: parent.left
                     anchors.margins: content.margin
                     anchors.verticalCenter: parent.verticalCenter
@@ -90,6 +97,12 @@ Item {
                 Connections {
                     target: notification
                     onExpired: fadeOutAnim.start()
+                    onUpdated: notif.update()
+                    onIconChanged: {
+                        var source = image.source;
+                        image.source = "";
+                        image.source = source;
+                    }
                 }
             }
         }
@@ -98,8 +111,7 @@ Item {
     Connections {
         target: NotificationsManager
         onNotify: {
-            component.createObject(root, { notification: notification, body: notification.body,
-                                           summary: notification.summary,
+            component.createObject(root, { notification: notification,
                                            icon: "image://notifications/" + notification.id });
         }
     }
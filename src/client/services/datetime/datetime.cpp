@@ -18,6 +18,7 @@
  */
 
 #include "datetime.h"
+#include "wakeupscheduler.h"
 
 #include <QDebug>
 #include <QtQml>
@@ -32,20 +33,23 @@ void DateTimePlugin::registerTypes(const char *uri)
 
 DateTime::DateTime(QObject *p)
         : QObject(p)
+        , m_timer(0)
 {
-    startTimer(250);
-
+    startTimer();
     setDT(QDateTime::currentDateTime());
 }
 
 DateTime::~DateTime()
 {
-
+    WakeupScheduler::instance()->remove(m_timer);
 }
 
 QString DateTime::time() const
 {
-    return m_dateTime.time().toString();
+    if (m_timeFormat.isEmpty()) {
+        return m_dateTime.time().toString();
+    }
+    return m_dateTime.time().toString(m_timeFormat);
 }
 
 QString DateTime::date() const
@@ -53,21 +57,37 @@ QString DateTime::date() const
     return m_dateTime.date().toString(Qt::DefaultLocaleShortDate);
 }
 
-void DateTime::timerEvent(QTimerEvent *event)
+void DateTime::setTimeFormat(const QString &format)
 {
-    QDateTime dt = QDateTime::currentDateTime();
-    if (dt.toTime_t() != m_nsecs) {
-        setDT(dt);
+    if (format != m_timeFormat) {
+        m_timeFormat = format;
+        startTimer();
+        emit timeFormatChanged();
+        setDT(QDateTime::currentDateTime());
     }
 }
 
+void DateTime::startTimer()
+{
+    // Wake up right after the second or minute changes, instead of polling
+    // the time four times per second
+    bool seconds = m_timeFormat.isEmpty() || m_timeFormat.contains('s');
+    WakeupScheduler *scheduler = WakeupScheduler::instance();
+    scheduler->remove(m_timer);
+    m_timer = scheduler->add("datetime", 0, 50, seconds ? WakeupScheduler::Align::Second : WakeupScheduler::Align::Minute, [this]() {
+        setDT(QDateTime::currentDateTime());
+    });
+}
+
 void DateTime::setDT(const QDateTime &dt)
 {
     QString d = date();
+    QString t = time();
     m_dateTime = dt;
-    m_nsecs = dt.toTime_t();
 
-    emit timeChanged();
+    if (t != time()) {
+        emit timeChanged();
+    }
     if (d != date()) {
         emit dateChanged();
     }
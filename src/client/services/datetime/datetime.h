@@ -36,6 +36,7 @@ class DateTime : public QObject
     Q_OBJECT
     Q_PROPERTY(QString time READ time NOTIFY timeChanged)
     Q_PROPERTY(QString date READ date NOTIFY dateChanged)
+    Q_PROPERTY(QString timeFormat READ timeFormat WRITE setTimeFormat NOTIFY timeFormatChanged)
 public:
     DateTime(QObject *p = nullptr);
     ~DateTime();
@@ -43,18 +44,23 @@ public:
     QString time() const;
     QString date() const;
 
+    // The QTime::toString() format of time. If it doesn't show the seconds
+    // the time is updated once per minute.
+    QString timeFormat() const { return m_timeFormat; }
+    void setTimeFormat(const QString &format);
+
 signals:
     void timeChanged();
     void dateChanged();
-
-protected:
-    virtual void timerEvent(QTimerEvent *event) override;
+    void timeFormatChanged();
 
 private:
+    void startTimer();
     void setDT(const QDateTime &dt);
 
     QDateTime m_dateTime;
-    uint m_nsecs;
+    QString m_timeFormat;
+    int m_timer;
 };
 
 #endif
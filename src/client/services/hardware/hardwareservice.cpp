@@ -21,6 +21,7 @@
 #include <QtQml>
 
 #include "hardwareservice.h"
+#include "nativebackend.h"
 #include "clibackend.h"
 #ifdef USE_SOLID
 #include "solidbackend.h"
@@ -98,6 +99,9 @@ HardwareManager::HardwareManager(QObject *p)
 #ifdef USE_SOLID
     m_backend = SolidBackend::create(this);
 #endif
+    if (!m_backend) {
+        m_backend = NativeBackend::create(this);
+    }
     if (!m_backend) {
         m_backend = CliBackend::create(this);
     }
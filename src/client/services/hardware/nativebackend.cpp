@@ -0,0 +1,348 @@
+/*
+ * Copyright 2015 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This file is part of Orbital
+ *
+ * Orbital is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Orbital is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Orbital.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <arpa/inet.h>
+
+#include <QSocketNotifier>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDBusConnection>
+#include <QDBusMessage>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
+#include <QDebug>
+
+#include "nativebackend.h"
+
+#define UDISKS_SERVICE QStringLiteral("org.freedesktop.UDisks2")
+#define UDISKS_FILESYSTEM_INTERFACE QStringLiteral("org.freedesktop.UDisks2.Filesystem")
+
+// The header udevd prepends to the events it sends on the netlink socket
+struct UdevMonitorHeader {
+    char prefix[8];
+    unsigned int magic;
+    unsigned int headerSize;
+    unsigned int propertiesOffset;
+    unsigned int propertiesLength;
+};
+static const unsigned int UdevMonitorMagic = 0xfeedcafe;
+static const int UdevMonitorGroup = 2;
+
+static QString env(const char *name, const QString &def)
+{
+    QByteArray v = qgetenv(name);
+    return v.isEmpty() ? def : QFile::decodeName(v);
+}
+
+static QByteArray readFile(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+    return file.readAll().trimmed();
+}
+
+// udisks escapes everything but [A-Za-z0-9] in the object paths
+static QString udisksPath(const QString &udi)
+{
+    QByteArray name = QFileInfo(udi).fileName().toLatin1();
+    QString path = QStringLiteral("/org/freedesktop/UDisks2/block_devices/");
+    for (char c: name) {
+        if (isalnum(c)) {
+            path += QLatin1Char(c);
+        } else {
+            path += QStringLiteral("_%1").arg((uchar)c, 2, 16, QLatin1Char('0'));
+        }
+    }
+    return path;
+}
+
+NativeDevice::NativeDevice(NativeBackend *backend, const QString &udi)
+            : Device(udi)
+            , m_backend(backend)
+{
+}
+
+bool NativeDevice::call(const QString &method)
+{
+    if (type() != Type::Storage) {
+        return false;
+    }
+
+    // No need to emit mountedChanged() here, the backend sees mountinfo change
+    QDBusMessage msg = QDBusMessage::createMethodCall(UDISKS_SERVICE, udisksPath(udi()), UDISKS_FILESYSTEM_INTERFACE, method);
+    msg << QVariantMap();
+    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(QDBusConnection::systemBus().asyncCall(msg), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished, [this, method](QDBusPendingCallWatcher *watcher) {
+        watcher->deleteLater();
+        QDBusPendingReply<> reply = *watcher;
+        if (reply.isError()) {
+            qWarning("%s of %s failed: %s", qPrintable(method), qPrintable(udi()), qPrintable(reply.error().message()));
+        }
+    });
+    return true;
+}
+
+bool NativeDevice::umount()
+{
+    return call(QStringLiteral("Unmount"));
+}
+
+bool NativeDevice::mount()
+{
+    return call(QStringLiteral("Mount"));
+}
+
+bool NativeDevice::isMounted() const
+{
+    return type() == Type::Storage && m_backend->isMounted(udi());
+}
+
+
+
+NativeBackend::NativeBackend(HardwareManager *hw, const QString &sysRoot, const QString &procRoot, const QString &udevRoot)
+             : QObject()
+             , HardwareManager::Backend(hw)
+             , m_sysRoot(sysRoot)
+             , m_procRoot(procRoot)
+             , m_udevRoot(udevRoot)
+             , m_mountsFd(-1)
+             , m_udevFd(-1)
+             , m_mountsNotifier(nullptr)
+             , m_udevNotifier(nullptr)
+{
+}
+
+NativeBackend::~NativeBackend()
+{
+    if (m_mountsFd >= 0) {
+        close(m_mountsFd);
+    }
+    if (m_udevFd >= 0) {
+        close(m_udevFd);
+    }
+}
+
+NativeBackend *NativeBackend::create(HardwareManager *hw)
+{
+    NativeBackend *backend = new NativeBackend(hw, env("ORBITAL_SYSFS_ROOT", QStringLiteral("/sys")),
+                                               env("ORBITAL_PROCFS_ROOT", QStringLiteral("/proc")),
+                                               env("ORBITAL_UDEV_ROOT", QStringLiteral("/run/udev")));
+    if (!backend->init()) {
+        delete backend;
+        return nullptr;
+    }
+    return backend;
+}
+
+bool NativeBackend::init()
+{
+    m_mountsFd = open(QFile::encodeName(m_procRoot + QStringLiteral("/self/mountinfo")).constData(), O_RDONLY | O_CLOEXEC);
+    if (m_mountsFd < 0) {
+        qWarning("Cannot open mountinfo: %s", strerror(errno));
+        return false;
+    }
+    // mountinfo signals POLLPRI when the mount table changes
+    m_mountsNotifier = new QSocketNotifier(m_mountsFd, QSocketNotifier::Exception, this);
+    connect(m_mountsNotifier, &QSocketNotifier::activated, this, &NativeBackend::readMounts);
+    readMounts();
+
+    m_udevFd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_KOBJECT_UEVENT);
+    if (m_udevFd >= 0) {
+        sockaddr_nl addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.nl_family = AF_NETLINK;
+        addr.nl_groups = UdevMonitorGroup;
+        int on = 1;
+        setsockopt(m_udevFd, SOL_SOCKET, SO_PASSCRED, &on, sizeof(on));
+        if (bind(m_udevFd, (sockaddr *)&addr, sizeof(addr)) == 0) {
+            m_udevNotifier = new QSocketNotifier(m_udevFd, QSocketNotifier::Read, this);
+            connect(m_udevNotifier, &QSocketNotifier::activated, this, &NativeBackend::udevEvent);
+        } else {
+            qWarning("Cannot listen to udev events, devices will not be updated: %s", strerror(errno));
+            close(m_udevFd);
+            m_udevFd = -1;
+        }
+    }
+
+    QDir dir(m_sysRoot + QStringLiteral("/class/block"));
+    foreach (const QString &name, dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot | QDir::System)) {
+        addDevice(name, udevProperties(name));
+    }
+    return true;
+}
+
+QHash<QByteArray, QByteArray> NativeBackend::udevProperties(const QString &name) const
+{
+    QHash<QByteArray, QByteArray> properties;
+    QByteArray dev = readFile(m_sysRoot + QStringLiteral("/class/block/") + name + QStringLiteral("/dev"));
+    if (dev.isEmpty()) {
+        return properties;
+    }
+
+    // The udev database has "E:KEY=value" lines for the device properties
+    QFile file(m_udevRoot + QStringLiteral("/data/b") + QString::fromLatin1(dev));
+    if (file.open(QIODevice::ReadOnly)) {
+        foreach (const QByteArray &line, file.readAll().split('\n')) {
+            int eq = line.indexOf('=');
+            if (line.startsWith("E:") && eq > 2) {
+                properties.insert(line.mid(2, eq - 2), line.mid(eq + 1));
+            }
+        }
+    }
+    return properties;
+}
+
+void NativeBackend::addDevice(const QString &name, const QHash<QByteArray, QByteArray> &properties)
+{
+    QString udi = QStringLiteral("/dev/") + name;
+    QByteArray fsType = properties.value("ID_FS_TYPE");
+
+    // The properties are constant, so a changed device is replaced
+    if (m_devices.contains(udi)) {
+        m_devices.remove(udi);
+        deviceRemoved(udi);
+    }
+    if (fsType.isEmpty()) {
+        return;
+    }
+
+    NativeDevice *d = new NativeDevice(this, udi);
+    if (fsType != "swap") {
+        d->setType(Device::Type::Storage);
+        if (properties.value("ID_CDROM") == "1" || name.startsWith(QLatin1String("sr"))) {
+            d->setIconName(QStringLiteral("media-optical"));
+        } else {
+            // partitions don't have the removable attribute, their disk does
+            QString path = QFileInfo(m_sysRoot + QStringLiteral("/class/block/") + name).canonicalFilePath();
+            QByteArray removable = readFile(path + QStringLiteral("/removable"));
+            if (removable.isEmpty()) {
+                removable = readFile(path + QStringLiteral("/../removable"));
+            }
+            d->setIconName(removable == "1" ? QStringLiteral("drive-removable-media") : QStringLiteral("drive-harddisk"));
+        }
+
+        QByteArray label = properties.value("ID_FS_LABEL");
+        d->setName(label.isEmpty() ? udi : QString::fromUtf8(label));
+    }
+    m_devices.insert(udi, d);
+    deviceAdded(d);
+}
+
+void NativeBackend::readMounts()
+{
+    QByteArray data;
+    char buf[4096];
+    ssize_t len;
+    off_t offset = 0;
+    while ((len = pread(m_mountsFd, buf, sizeof(buf), offset)) > 0) {
+        data.append(buf, len);
+        offset += len;
+    }
+
+    // "36 35 98:0 /mnt1 /mnt/parent rw,noatime master:1 - ext3 /dev/root rw,errors=continue"
+    QSet<QString> mounted;
+    foreach (const QByteArray &line, data.split('\n')) {
+        int sep = line.indexOf(" - ");
+        if (sep < 0) {
+            continue;
+        }
+        QList<QByteArray> fields = line.mid(sep + 3).split(' ');
+        if (fields.count() >= 2 && fields.at(1).startsWith("/dev/")) {
+            mounted.insert(QFile::decodeName(fields.at(1)));
+        }
+    }
+
+    QSet<QString> changed = (mounted - m_mounted) + (m_mounted - mounted);
+    m_mounted = mounted;
+    foreach (const QString &udi, changed) {
+        if (NativeDevice *d = m_devices.value(udi)) {
+            emit d->mountedChanged();
+        }
+    }
+}
+
+void NativeBackend::udevEvent()
+{
+    char buf[8192];
+    char control[CMSG_SPACE(sizeof(ucred))];
+    sockaddr_nl addr;
+    iovec iov = { buf, sizeof(buf) };
+    msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_name = &addr;
+    msg.msg_namelen = sizeof(addr);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ssize_t len = recvmsg(m_udevFd, &msg, 0);
+    if (len < (ssize_t)sizeof(UdevMonitorHeader)) {
+        return;
+    }
+
+    // Only trust udevd, which runs as root
+    cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    if (!cmsg || cmsg->cmsg_type != SCM_CREDENTIALS || addr.nl_pid == 0 ||
+        reinterpret_cast<ucred *>(CMSG_DATA(cmsg))->uid != 0) {
+        return;
+    }
+
+    const UdevMonitorHeader *header = reinterpret_cast<const UdevMonitorHeader *>(buf);
+    if (strcmp(header->prefix, "libudev") != 0 || ntohl(header->magic) != UdevMonitorMagic ||
+        header->propertiesOffset + header->propertiesLength > (size_t)len) {
+        return;
+    }
+
+    QHash<QByteArray, QByteArray> properties;
+    QByteArray data = QByteArray::fromRawData(buf + header->propertiesOffset, header->propertiesLength);
+    foreach (const QByteArray &p, data.split('\0')) {
+        int eq = p.indexOf('=');
+        if (eq > 0) {
+            properties.insert(p.left(eq), p.mid(eq + 1));
+        }
+    }
+
+    if (properties.value("SUBSYSTEM") != "block") {
+        return;
+    }
+    QString name = QFileInfo(QFile::decodeName(properties.value("DEVNAME"))).fileName();
+    if (name.isEmpty()) {
+        return;
+    }
+
+    QByteArray action = properties.value("ACTION");
+    if (action == "remove") {
+        QString udi = QStringLiteral("/dev/") + name;
+        if (m_devices.remove(udi)) {
+            deviceRemoved(udi);
+        }
+    } else if (action == "add" || action == "change") {
+        addDevice(name, properties);
+    }
+}
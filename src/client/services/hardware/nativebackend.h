@@ -0,0 +1,79 @@
+/*
+ * Copyright 2015 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This file is part of Orbital
+ *
+ * Orbital is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Orbital is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Orbital.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NATIVEBACKEND_H
+#define NATIVEBACKEND_H
+
+#include <QSet>
+#include <QHash>
+
+#include "hardwareservice.h"
+
+class QSocketNotifier;
+class NativeBackend;
+
+class NativeDevice : public Device
+{
+public:
+    NativeDevice(NativeBackend *backend, const QString &udi);
+
+    bool umount() override;
+    bool mount() override;
+    bool isMounted() const override;
+
+private:
+    bool call(const QString &method);
+
+    NativeBackend *m_backend;
+};
+
+// Reads the block devices from sysfs and the udev database and the mounts
+// from mountinfo, and keeps them up to date watching mountinfo and the udev
+// netlink socket. The roots are configurable so that it can run against a
+// fake tree: ORBITAL_SYSFS_ROOT, ORBITAL_PROCFS_ROOT and ORBITAL_UDEV_ROOT
+// override /sys, /proc and /run/udev.
+class NativeBackend : public QObject, public HardwareManager::Backend
+{
+public:
+    ~NativeBackend();
+
+    static NativeBackend *create(HardwareManager *hw);
+
+    bool isMounted(const QString &udi) const { return m_mounted.contains(udi); }
+
+private:
+    NativeBackend(HardwareManager *hw, const QString &sysRoot, const QString &procRoot, const QString &udevRoot);
+    bool init();
+    void addDevice(const QString &name, const QHash<QByteArray, QByteArray> &properties);
+    QHash<QByteArray, QByteArray> udevProperties(const QString &name) const;
+    void readMounts();
+    void udevEvent();
+
+    QString m_sysRoot;
+    QString m_procRoot;
+    QString m_udevRoot;
+    int m_mountsFd;
+    int m_udevFd;
+    QSocketNotifier *m_mountsNotifier;
+    QSocketNotifier *m_udevNotifier;
+    QHash<QString, NativeDevice *> m_devices;
+    QSet<QString> m_mounted;
+};
+
+#endif
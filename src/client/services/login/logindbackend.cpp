@@ -116,12 +116,17 @@ void LogindBackend::takeSleepLock()
 void LogindBackend::prepareForSleep(bool v)
 {
     if (v) {
+        m_sleepTimer.start();
         emit requestLock();
     }
 }
 
 void LogindBackend::locked()
 {
+    if (m_sleepTimer.isValid()) {
+        qDebug("Locked for sleep in %lld ms", m_sleepTimer.elapsed());
+        m_sleepTimer.invalidate();
+    }
     if (m_inhibitFd >= 0) {
         close(m_inhibitFd);
         m_inhibitFd = -1;
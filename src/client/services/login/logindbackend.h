@@ -20,6 +20,8 @@
 #ifndef LOGINDBACKEND_H
 #define LOGINDBACKEND_H
 
+#include <QElapsedTimer>
+
 #include "loginservice.h"
 
 class QDBusPendingCallWatcher;
@@ -49,6 +51,7 @@ private:
     DBusInterface *m_interface;
     QString m_sessionPath;
     int m_inhibitFd;
+    QElapsedTimer m_sleepTimer;
 };
 
 #endif
@@ -17,6 +17,11 @@
  * along with Orbital.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <poll.h>
+
+#include <QSocketNotifier>
+#include <QVector>
+
 #include "alsamixer.h"
 #include "client.h"
 
@@ -26,6 +31,8 @@ static const char *selem_name = "Master";
 AlsaMixer::AlsaMixer(Mixer *m)
          : Backend()
          , m_mixer(m)
+         , m_handle(nullptr)
+         , m_sid(nullptr)
 {
 }
 
@@ -41,7 +48,7 @@ AlsaMixer *AlsaMixer::create(Mixer *m)
     snd_mixer_selem_register(alsa->m_handle, NULL, NULL);
     snd_mixer_load(alsa->m_handle);
 
-    snd_mixer_selem_id_alloca(&alsa->m_sid);
+    snd_mixer_selem_id_malloc(&alsa->m_sid);
     snd_mixer_selem_id_set_index(alsa->m_sid, 0);
     snd_mixer_selem_id_set_name(alsa->m_sid, selem_name);
     alsa->m_elem = snd_mixer_find_selem(alsa->m_handle, alsa->m_sid);
@@ -51,12 +58,36 @@ AlsaMixer *AlsaMixer::create(Mixer *m)
     }
 
     snd_mixer_selem_get_playback_volume_range(alsa->m_elem, &alsa->m_min, &alsa->m_max);
+
+    // Let the mixer tell us when the volume changes instead of asking it
+    int count = snd_mixer_poll_descriptors_count(alsa->m_handle);
+    if (count > 0) {
+        QVector<pollfd> fds(count);
+        count = snd_mixer_poll_descriptors(alsa->m_handle, fds.data(), count);
+        for (int i = 0; i < count; ++i) {
+            QSocketNotifier *notifier = new QSocketNotifier(fds[i].fd, QSocketNotifier::Read);
+            QObject::connect(notifier, &QSocketNotifier::activated, [alsa]() { alsa->handleEvents(); });
+            alsa->m_notifiers << notifier;
+        }
+    }
     return alsa;
 }
 
 AlsaMixer::~AlsaMixer()
 {
-    snd_mixer_close(m_handle);
+    qDeleteAll(m_notifiers);
+    if (m_sid) {
+        snd_mixer_selem_id_free(m_sid);
+    }
+    if (m_handle) {
+        snd_mixer_close(m_handle);
+    }
+}
+
+void AlsaMixer::handleEvents()
+{
+    snd_mixer_handle_events(m_handle);
+    m_mixer->stateChanged();
 }
 
 void AlsaMixer::getBoundaries(int *min, int *max) const
@@ -68,7 +99,6 @@ void AlsaMixer::getBoundaries(int *min, int *max) const
 void AlsaMixer::setRawVol(int volume)
 {
     snd_mixer_selem_set_playback_volume_all(m_elem, volume);
-    emit m_mixer->masterChanged();
 }
 
 int AlsaMixer::rawVol() const
@@ -88,5 +118,4 @@ bool AlsaMixer::muted() const
 void AlsaMixer::setMuted(bool muted)
 {
     snd_mixer_selem_set_playback_switch_all(m_elem, !muted);
-    emit m_mixer->mutedChanged();
 }
@@ -22,8 +22,12 @@
 
 #include <alsa/asoundlib.h>
 
+#include <QList>
+
 #include "mixerservice.h"
 
+class QSocketNotifier;
+
 class AlsaMixer : public Backend
 {
 public:
@@ -40,6 +44,7 @@ public:
 
 private:
     AlsaMixer(Mixer *mixer);
+    void handleEvents();
 
     Mixer *m_mixer;
     snd_mixer_t *m_handle;
@@ -47,6 +52,7 @@ private:
     snd_mixer_elem_t *m_elem;
     long m_min;
     long m_max;
+    QList<QSocketNotifier *> m_notifiers;
 };
 
 #endif
@@ -42,8 +42,15 @@ void MixerPlugin::registerTypes(const char *uri)
 
 Mixer::Mixer(QObject *p)
             : QObject(p)
+            , m_rawVol(0)
+            , m_muted(false)
+            , m_pendingVol(-1)
             , m_backend(nullptr)
 {
+    m_writeTimer.setSingleShot(true);
+    m_writeTimer.setInterval(16);
+    connect(&m_writeTimer, &QTimer::timeout, this, &Mixer::writeVolume);
+
     m_backend = PulseAudioMixer::create(this);
     if (!m_backend) {
 #ifdef HAVE_ALSA
@@ -57,6 +64,8 @@ Mixer::Mixer(QObject *p)
 
     m_backend->getBoundaries(&m_min, &m_max);
     m_step = (m_max - m_min) / 50;
+    m_rawVol = m_backend->rawVol();
+    m_muted = m_backend->muted();
 
     Client::client()->addAction("Mixer.increaseVolume", [this]() { increaseMaster(); emit bindingTriggered(); });
     Client::client()->addAction("Mixer.decreaseVolume", [this]() { decreaseMaster(); emit bindingTriggered(); });
@@ -68,6 +77,55 @@ Mixer::~Mixer()
     delete m_backend;
 }
 
+void Mixer::stateChanged()
+{
+    // A write not yet sent would be overwritten by the old hardware volume
+    if (m_pendingVol < 0) {
+        int vol = m_backend->rawVol();
+        if (vol != m_rawVol) {
+            m_rawVol = vol;
+            emit masterChanged();
+        }
+    }
+    bool muted = m_backend->muted();
+    if (muted != m_muted) {
+        m_muted = muted;
+        emit mutedChanged();
+    }
+}
+
+void Mixer::setRawVol(int vol)
+{
+    if (!m_backend) {
+        return;
+    }
+
+    if (m_muted) {
+        setMuted(false);
+    }
+    if (vol == m_rawVol) {
+        return;
+    }
+    m_rawVol = vol;
+    m_pendingVol = vol;
+    emit masterChanged();
+
+    if (!m_writeTimer.isActive()) {
+        writeVolume();
+        m_writeTimer.start();
+    }
+}
+
+void Mixer::writeVolume()
+{
+    if (m_pendingVol >= 0) {
+        m_backend->setRawVol(m_pendingVol);
+        m_pendingVol = -1;
+        // Keep the timer going while the writes keep coming
+        m_writeTimer.start();
+    }
+}
+
 void Mixer::changeMaster(int change)
 {
     setMaster(master() + change);
@@ -75,56 +133,42 @@ void Mixer::changeMaster(int change)
 
 void Mixer::increaseMaster()
 {
-    if (m_backend) {
-        long v = qBound(m_min, m_backend->rawVol() + m_step, m_max);
-        m_backend->setRawVol(v);
-    }
+    setRawVol(qBound(m_min, m_rawVol + m_step, m_max));
 }
 
 void Mixer::decreaseMaster()
 {
-    if (m_backend) {
-        long v = qBound(m_min, m_backend->rawVol() - m_step, m_max);
-        m_backend->setRawVol(v);
-    }
+    setRawVol(qBound(m_min, m_rawVol - m_step, m_max));
 }
 
 void Mixer::setMaster(int volume)
 {
-    if (m_backend) {
-        int v = qBound(m_min, (int)((double)volume * (double)m_max / 100.), m_max);
-        m_backend->setRawVol(v);
-    }
+    setRawVol(qBound(m_min, (int)((double)volume * (double)m_max / 100.), m_max));
 }
 
 int Mixer::master() const
 {
     if (m_backend) {
-        int vol = m_backend->rawVol();
-        vol = (float)vol * 100.f / (float)m_max;
-        return vol;
+        return (float)m_rawVol * 100.f / (float)m_max;
     }
     return 0;
 }
 
 bool Mixer::muted() const
 {
-    if (m_backend) {
-        return m_backend->muted();
-    }
-    return false;
+    return m_muted;
 }
 
 void Mixer::setMuted(bool muted)
 {
-    if (m_backend) {
+    if (m_backend && muted != m_muted) {
+        m_muted = muted;
         m_backend->setMuted(muted);
+        emit mutedChanged();
     }
 }
 
 void Mixer::toggleMuted()
 {
-    if (m_backend) {
-        setMuted(!m_backend->muted());
-    }
+    setMuted(!m_muted);
 }
@@ -21,6 +21,7 @@
 #define VOLUMECONTROL_H
 
 #include <QQmlExtensionPlugin>
+#include <QTimer>
 
 class MixerPlugin : public QQmlExtensionPlugin
 {
@@ -55,6 +56,9 @@ public:
     bool muted() const;
     void setMuted(bool muted);
 
+    // Called by the backends when the hardware state changed
+    void stateChanged();
+
 public slots:
     void increaseMaster();
     void decreaseMaster();
@@ -71,6 +75,14 @@ private:
     int m_min;
     int m_max;
     int m_step;
+    int m_rawVol;
+    bool m_muted;
+    // Volume writes are coalesced, at most one per frame
+    int m_pendingVol;
+    QTimer m_writeTimer;
+
+    void setRawVol(int vol);
+    void writeVolume();
 
     Backend *m_backend;
 };
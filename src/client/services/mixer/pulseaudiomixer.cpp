@@ -29,6 +29,7 @@ struct Sink
 {
     Sink() : muted(false) {}
     uint32_t index;
+    QByteArray name;
     pa_cvolume volume;
     bool muted;
 };
@@ -36,16 +37,17 @@ struct Sink
 PulseAudioMixer::PulseAudioMixer(Mixer *m)
                : Backend()
                , m_mixer(m)
-               , m_sink(new Sink)
+               , m_sink(nullptr)
+               , m_introspections(0)
+               , m_changes(0)
 {
 }
 
 PulseAudioMixer::~PulseAudioMixer()
 {
-    delete m_sink;
+    qDeleteAll(m_sinks);
     cleanup();
 }
-
 PulseAudioMixer *PulseAudioMixer::create(Mixer *mixer)
 {
     PulseAudioMixer *pulse = new PulseAudioMixer(mixer);
@@ -94,11 +96,14 @@ void PulseAudioMixer::contextStateCallback(pa_context *c)
             pa_context_set_subscribe_callback(c, [](pa_context *c, pa_subscription_event_type_t t, uint32_t index, void *ud) {
                 static_cast<PulseAudioMixer *>(ud)->subscribeCallback(c, t, index);
             }, this);
-            pa_context_subscribe(c, PA_SUBSCRIPTION_MASK_SINK, nullptr, nullptr);
+            pa_context_subscribe(c, (pa_subscription_mask_t)(PA_SUBSCRIPTION_MASK_SINK | PA_SUBSCRIPTION_MASK_SERVER), nullptr, nullptr);
 
-            pa_context_get_sink_info_list(c, [](pa_context *c, const pa_sink_info *i, int eol, void *ud) {
+            // Fetch everything once, after this the events tell which sink to re-read
+            getServerInfo();
+            ++m_introspections;
+            pa_operation_unref(pa_context_get_sink_info_list(c, [](pa_context *c, const pa_sink_info *i, int eol, void *ud) {
                 static_cast<PulseAudioMixer *>(ud)->sinkCallback(c, i, eol);
-            }, this);
+            }, this));
             break;
 
         case PA_CONTEXT_TERMINATED:
@@ -117,15 +122,51 @@ void PulseAudioMixer::subscribeCallback(pa_context *c, pa_subscription_event_typ
 {
     switch (t & PA_SUBSCRIPTION_EVENT_FACILITY_MASK) {
         case PA_SUBSCRIPTION_EVENT_SINK:
-            pa_context_get_sink_info_list(c, [](pa_context *c, const pa_sink_info *i, int eol, void *ud) {
-                static_cast<PulseAudioMixer *>(ud)->sinkCallback(c, i, eol);
-            }, this);
+            if ((t & PA_SUBSCRIPTION_EVENT_TYPE_MASK) == PA_SUBSCRIPTION_EVENT_REMOVE) {
+                Sink *sink = m_sinks.take(index);
+                if (sink == m_sink) {
+                    // The server will send a change event with the new default sink
+                    setDefaultSink(nullptr);
+                }
+                delete sink;
+            } else {
+                getSinkInfo(index);
+            }
+            break;
+        case PA_SUBSCRIPTION_EVENT_SERVER:
+            getServerInfo();
             break;
         default:
             break;
     }
 }
 
+void PulseAudioMixer::getServerInfo()
+{
+    ++m_introspections;
+    pa_operation_unref(pa_context_get_server_info(m_context, [](pa_context *, const pa_server_info *i, void *ud) {
+        static_cast<PulseAudioMixer *>(ud)->serverCallback(i);
+    }, this));
+}
+
+void PulseAudioMixer::getSinkInfo(uint32_t index)
+{
+    ++m_introspections;
+    pa_operation_unref(pa_context_get_sink_info_by_index(m_context, index, [](pa_context *c, const pa_sink_info *i, int eol, void *ud) {
+        static_cast<PulseAudioMixer *>(ud)->sinkCallback(c, i, eol);
+    }, this));
+}
+
+void PulseAudioMixer::serverCallback(const pa_server_info *i)
+{
+    if (!i) {
+        return;
+    }
+
+    m_defaultSinkName = i->default_sink_name;
+    setDefaultSink(defaultSink());
+}
+
 void PulseAudioMixer::sinkCallback(pa_context *c, const pa_sink_info *i, int eol)
 {
     if (eol < 0) {
@@ -140,13 +181,59 @@ void PulseAudioMixer::sinkCallback(pa_context *c, const pa_sink_info *i, int eol
         return;
     }
 
-    m_sink->index = i->index;
-    if (m_sink->muted != (bool)i->mute) {
-        m_sink->muted = (bool)i->mute;
-        emit m_mixer->mutedChanged();
+    Sink *sink = m_sinks.value(i->index);
+    if (!sink) {
+        sink = new Sink;
+        sink->index = i->index;
+        sink->name = i->name;
+        sink->volume = i->volume;
+        sink->muted = i->mute;
+        m_sinks.insert(i->index, sink);
+        if (!m_sink || sink->name == m_defaultSinkName) {
+            setDefaultSink(defaultSink());
+        }
+        return;
+    }
+
+    bool mutedChanged = sink->muted != (bool)i->mute;
+    bool volumeChanged = !pa_cvolume_equal(&sink->volume, &i->volume);
+    sink->muted = i->mute;
+    sink->volume = i->volume;
+
+    // Only the default sink is visible, and only if something actually changed
+    if (sink == m_sink && (mutedChanged || volumeChanged)) {
+        m_mixer->stateChanged();
+        changed();
+    }
+}
+
+Sink *PulseAudioMixer::defaultSink() const
+{
+    foreach (Sink *sink, m_sinks) {
+        if (sink->name == m_defaultSinkName) {
+            return sink;
+        }
+    }
+    // Until the server tells us the default sink use any
+    return m_sinks.isEmpty() ? nullptr : *m_sinks.begin();
+}
+
+void PulseAudioMixer::setDefaultSink(Sink *sink)
+{
+    if (sink == m_sink) {
+        return;
+    }
+
+    m_sink = sink;
+    m_mixer->stateChanged();
+    changed();
+}
+
+void PulseAudioMixer::changed()
+{
+    if (++m_changes % 100 == 0) {
+        qDebug("PulseAudio mixer: %d introspection calls for %d visible changes", m_introspections, m_changes);
     }
-    m_sink->volume = i->volume;
-    emit m_mixer->masterChanged();
 }
 
 void PulseAudioMixer::cleanup()
@@ -162,27 +249,34 @@ void PulseAudioMixer::getBoundaries(int *min, int *max) const
 
 void PulseAudioMixer::setRawVol(int vol)
 {
+    if (!m_sink) {
+        return;
+    }
     if (!pa_channels_valid(m_sink->volume.channels)) {
         qWarning("Cannot change Pulseaudio volume: invalid channels %d", m_sink->volume.channels);
         return;
     }
 
-    setMuted(false);
+    // Update the cached volume right away, so that the server event
+    // will find it unchanged
     pa_cvolume_set(&m_sink->volume, m_sink->volume.channels, vol);
-    pa_context_set_sink_volume_by_index(m_context, m_sink->index, &m_sink->volume, nullptr, nullptr);
+    pa_operation_unref(pa_context_set_sink_volume_by_index(m_context, m_sink->index, &m_sink->volume, nullptr, nullptr));
 }
 
 int PulseAudioMixer::rawVol() const
 {
-    return pa_cvolume_avg(&m_sink->volume);
+    return m_sink ? pa_cvolume_avg(&m_sink->volume) : PA_VOLUME_MUTED;
 }
 
 bool PulseAudioMixer::muted() const
 {
-    return m_sink->muted;
+    return m_sink && m_sink->muted;
 }
 
 void PulseAudioMixer::setMuted(bool muted)
 {
-    pa_context_set_sink_mute_by_index(m_context, m_sink->index, muted, nullptr, nullptr);
+    if (m_sink && m_sink->muted != muted) {
+        m_sink->muted = muted;
+        pa_operation_unref(pa_context_set_sink_mute_by_index(m_context, m_sink->index, muted, nullptr, nullptr));
+    }
 }
@@ -22,6 +22,9 @@
 
 #include <pulse/pulseaudio.h>
 
+#include <QHash>
+#include <QByteArray>
+
 #include "mixerservice.h"
 
 struct pa_glib_mainloop;
@@ -46,14 +49,24 @@ private:
     PulseAudioMixer(Mixer *mixer);
     void contextStateCallback(pa_context *c);
     void subscribeCallback(pa_context *c, pa_subscription_event_type_t t, uint32_t index);
+    void serverCallback(const pa_server_info *i);
     void sinkCallback(pa_context *c, const pa_sink_info *i, int eol);
+    void getServerInfo();
+    void getSinkInfo(uint32_t index);
+    Sink *defaultSink() const;
+    void setDefaultSink(Sink *sink);
+    void changed();
     void cleanup();
 
     Mixer *m_mixer;
     pa_glib_mainloop *m_mainLoop;
     pa_mainloop_api *m_mainloopApi;
     pa_context *m_context;
+    QHash<uint32_t, Sink *> m_sinks;
+    QByteArray m_defaultSinkName;
     Sink *m_sink;
+    int m_introspections;
+    int m_changes;
 };
 
 #endif
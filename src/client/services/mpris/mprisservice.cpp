@@ -27,6 +27,7 @@
 
 #include "mprisservice.h"
 #include "dbusinterface.h"
+#include "wakeupscheduler.h"
 
 #define DBUS_SERVICE QStringLiteral("org.freedesktop.DBus")
 #define MPRIS_PATH QStringLiteral("/org/mpris/MediaPlayer2")
@@ -39,6 +40,81 @@ void MprisPlugin::registerTypes(const char *uri)
     qmlRegisterType<Mpris>(uri, 1, 0, "Mpris");
 }
 
+MprisRegistry::MprisRegistry()
+             : QObject()
+{
+    QDBusConnectionInterface *bus = QDBusConnection::sessionBus().interface();
+    if (!bus) {
+        return;
+    }
+    connect(bus, &QDBusConnectionInterface::serviceOwnerChanged, this, &MprisRegistry::ownerChanged);
+
+    QDBusPendingCall call = bus->asyncCall(QStringLiteral("ListNames"));
+    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(call, this);
+    connect(watcher, &QDBusPendingCallWatcher::finished, [this](QDBusPendingCallWatcher *watcher) {
+        watcher->deleteLater();
+        QDBusPendingReply<QStringList> reply = *watcher;
+
+        if (reply.isError()) {
+            qDebug("Failed to get the list of DBus services.");
+            return;
+        }
+        foreach (const QString &name, reply.value()) {
+            addPlayer(name);
+        }
+    });
+}
+
+MprisRegistry *MprisRegistry::instance()
+{
+    static MprisRegistry *registry = new MprisRegistry;
+    return registry;
+}
+
+QString MprisRegistry::service(quint64 pid) const
+{
+    for (auto i = m_players.constBegin(); i != m_players.constEnd(); ++i) {
+        if (i.value() == pid) {
+            return i.key();
+        }
+    }
+    return QString();
+}
+
+void MprisRegistry::ownerChanged(const QString &name, const QString &oldOwner, const QString &newOwner)
+{
+    if (!oldOwner.isEmpty() && m_players.remove(name)) {
+        emit playerRemoved(name);
+    }
+    if (!newOwner.isEmpty()) {
+        addPlayer(name);
+    }
+}
+
+void MprisRegistry::addPlayer(const QString &name)
+{
+    if (!name.startsWith(MPRIS_INTERFACE + '.')) {
+        return;
+    }
+
+    DBusInterface iface(DBUS_SERVICE, QStringLiteral("/"), DBUS_SERVICE);
+    QDBusPendingCall call = iface.asyncCall(QStringLiteral("GetConnectionUnixProcessID"), name);
+    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(call, this);
+    connect(watcher, &QDBusPendingCallWatcher::finished, [this, name](QDBusPendingCallWatcher *watcher) {
+        watcher->deleteLater();
+        QDBusPendingReply<quint32> reply = *watcher;
+
+        if (reply.isError()) {
+            qDebug("Unable to get the pid of service %s.", qPrintable(name));
+        } else {
+            quint64 pid = reply.value();
+            m_players.insert(name, pid);
+            emit playerAdded(name, pid);
+        }
+    });
+}
+
+
 Mpris::Mpris(QObject *p)
             : QObject(p)
             , m_valid(false)
@@ -46,13 +122,20 @@ Mpris::Mpris(QObject *p)
             , m_playbackStatus(PlaybackStatus::Stopped)
             , m_trackLength(0)
             , m_trackPosition(0)
+            , m_rate(1.)
+            , m_positionUpdateInterval(0)
+            , m_positionTimer(0)
 {
-    m_posTimer.setInterval(1000);
-    connect(&m_posTimer, &QTimer::timeout, this, &Mpris::updatePos);
+    m_positionTime.start();
+
+    MprisRegistry *registry = MprisRegistry::instance();
+    connect(registry, &MprisRegistry::playerAdded, this, &Mpris::playerAdded);
+    connect(registry, &MprisRegistry::playerRemoved, this, &Mpris::playerRemoved);
 }
 
 Mpris::~Mpris()
 {
+    WakeupScheduler::instance()->remove(m_positionTimer);
 }
 
 bool Mpris::isValid() const
@@ -70,7 +153,6 @@ void Mpris::setPid(quint64 pid)
     if (m_pid != pid) {
         m_pid = pid;
         emit targetChanged();
-        setValid(false);
         checkConnection();
     }
 }
@@ -105,46 +187,30 @@ void Mpris::checkConnection()
         QDBusConnection::sessionBus().disconnect(m_service, MPRIS_PATH, DBUS_PROPERTIES_INTERFACE,
                                                  QStringLiteral("PropertiesChanged"),
                                                  this, SLOT(propertiesChanged(QString, QMap<QString, QVariant>, QStringList)));
+        QDBusConnection::sessionBus().disconnect(m_service, MPRIS_PATH, MPRIS_PLAYER_INTERFACE,
+                                                 QStringLiteral("Seeked"),
+                                                 this, SLOT(seeked(qint64)));
+        setValid(false);
     }
+    m_service = QString();
 
-    DBusInterface iface(DBUS_SERVICE, QStringLiteral("/"), DBUS_SERVICE);
-    if (!iface.isValid()) {
-        return;
+    QString service = MprisRegistry::instance()->service(m_pid);
+    if (!service.isEmpty()) {
+        checkService(service);
     }
-    QDBusPendingCall call = iface.asyncCall(QStringLiteral("ListNames"));
-    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(call);
-    watcher->connect(watcher, &QDBusPendingCallWatcher::finished, [this](QDBusPendingCallWatcher *watcher) {
-        watcher->deleteLater();
-        QDBusPendingReply<QStringList> reply = *watcher;
+}
 
-        if (reply.isError()) {
-            qDebug("Failed to get the list of DBus services.");
-        } else {
-            QStringList services = reply.value();
-            checkServices(services);
-        }
-    });
+void Mpris::playerAdded(const QString &service, quint64 pid)
+{
+    if (!m_valid && pid == m_pid) {
+        checkService(service);
+    }
 }
 
-void Mpris::checkServices(const QStringList &services)
+void Mpris::playerRemoved(const QString &service)
 {
-    DBusInterface iface(DBUS_SERVICE, QStringLiteral("/"), DBUS_SERVICE);
-    foreach (const QString &service, services) {
-        QDBusPendingCall call = iface.asyncCall(QStringLiteral("GetConnectionUnixProcessID"), service);
-        QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(call);
-        watcher->connect(watcher, &QDBusPendingCallWatcher::finished, [this, service](QDBusPendingCallWatcher *watcher) {
-            watcher->deleteLater();
-            QDBusPendingReply<quint32> reply = *watcher;
-
-            if (reply.isError()) {
-                qDebug("Unable to get the pid of service %s.", qPrintable(service));
-            } else {
-                quint32 p = reply.value();
-                if (p == m_pid) {
-                    checkService(service);
-                }
-            }
-        });
+    if (m_valid && service == m_service) {
+        checkConnection();
     }
 }
 
@@ -226,6 +292,7 @@ void Mpris::updateMetadata(const QVariantMap &md)
     m_trackTitle = QString();
     m_trackLength = 0;
     m_trackPosition = 0;
+    m_positionTime.restart();
     for (auto i = md.begin(); i != md.end(); ++i) {
         if (i.key() == QStringLiteral("xesam:title")) {
             m_trackTitle = i.value().toString();
@@ -248,35 +315,42 @@ void Mpris::updatePlaybackStatus(const QString &st)
 {
     PlaybackStatus old = m_playbackStatus;
 
-    m_posTimer.stop();
     if (st == QStringLiteral("Playing")) {
         m_playbackStatus = PlaybackStatus::Playing;
-        m_posTimer.start();
     } else if (st == QStringLiteral("Paused")) {
-        if (m_playbackStatus == PlaybackStatus::Playing) {
-            m_trackPosition += m_posTimer.remainingTime();
-            emit trackPositionChanged();
-        }
         m_playbackStatus = PlaybackStatus::Paused;
     } else {
         m_playbackStatus = PlaybackStatus::Stopped;
-        m_trackPosition = 0;
-        emit trackPositionChanged();
     }
-    if (m_playbackStatus != old) {
-        emit playbackStatusChanged();
+    if (m_playbackStatus == old) {
+        return;
+    }
+
+    // Stop extrapolating from where we were, and ask the player where it really is
+    if (old == PlaybackStatus::Playing) {
+        setPosition(trackPosition());
+    }
+    if (m_playbackStatus == PlaybackStatus::Stopped) {
+        setPosition(0);
+    } else {
+        getPosition();
     }
+    updatePositionTimer();
+    emit playbackStatusChanged();
 }
 
 void Mpris::getRate()
 {
     getProperty(QStringLiteral("Rate"), [this](const QVariant &v) {
-        updateRate(v.toDouble());
+        updateRate(v.isValid() ? v.toDouble() : 1.);
     });
 }
 
 void Mpris::updateRate(double rate)
 {
+    // the position so far was at the old rate
+    m_trackPosition = trackPosition();
+    m_positionTime.restart();
     m_rate = rate;
     emit rateChanged();
 }
@@ -284,24 +358,71 @@ void Mpris::updateRate(double rate)
 void Mpris::getPosition()
 {
     getProperty(QStringLiteral("Position"), [this](const QVariant &v) {
-        m_trackPosition = v.toDouble() / 1000;
-        emit trackPositionChanged();
+        if (v.isValid()) {
+            setPosition(v.toLongLong() / 1000);
+        }
     });
 }
 
-void Mpris::updatePos()
+void Mpris::setPosition(qint64 position)
 {
-    m_trackPosition += m_posTimer.interval();
+    m_trackPosition = position;
+    m_positionTime.restart();
     emit trackPositionChanged();
 }
 
 quint32 Mpris::trackPosition() const
 {
+    qint64 position = m_trackPosition;
+    if (m_playbackStatus == PlaybackStatus::Playing) {
+        position += m_positionTime.elapsed() * m_rate;
+    }
     // https://github.com/clementine-player/Clementine/issues/5097
-    if (m_trackPosition > m_trackLength) {
+    if (position > m_trackLength || position < 0) {
         return 0;
     }
-    return m_trackPosition;
+    return position;
+}
+
+void Mpris::setPositionUpdateInterval(int interval)
+{
+    if (interval != m_positionUpdateInterval) {
+        m_positionUpdateInterval = qMax(0, interval);
+        WakeupScheduler::instance()->remove(m_positionTimer);
+        m_positionTimer = 0;
+        updatePositionTimer();
+        emit positionUpdateIntervalChanged();
+    }
+}
+
+void Mpris::updatePositionTimer()
+{
+    static const QMetaMethod signal = QMetaMethod::fromSignal(&Mpris::trackPositionChanged);
+    WakeupScheduler *scheduler = WakeupScheduler::instance();
+    if (m_playbackStatus == PlaybackStatus::Playing && m_positionUpdateInterval > 0 && isSignalConnected(signal)) {
+        if (!m_positionTimer) {
+            // nobody will notice if a progress bar moves a bit late
+            m_positionTimer = scheduler->add("mpris", m_positionUpdateInterval, m_positionUpdateInterval / 4,
+                                             WakeupScheduler::Align::None, [this]() { emit trackPositionChanged(); });
+        }
+    } else {
+        scheduler->remove(m_positionTimer);
+        m_positionTimer = 0;
+    }
+}
+
+void Mpris::connectNotify(const QMetaMethod &signal)
+{
+    if (signal == QMetaMethod::fromSignal(&Mpris::trackPositionChanged)) {
+        updatePositionTimer();
+    }
+}
+
+void Mpris::disconnectNotify(const QMetaMethod &signal)
+{
+    if (signal == QMetaMethod::fromSignal(&Mpris::trackPositionChanged)) {
+        updatePositionTimer();
+    }
 }
 
 void Mpris::propertiesChanged(const QString &, const QMap<QString, QVariant> &changed, const QStringList &invalidated)
@@ -331,6 +452,5 @@ void Mpris::propertiesChanged(const QString &, const QMap<QString, QVariant> &ch
 
 void Mpris::seeked(qint64 time)
 {
-    m_trackPosition = time / 1000;
-    emit trackPositionChanged();
+    setPosition(time / 1000);
 }
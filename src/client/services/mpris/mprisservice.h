@@ -23,7 +23,8 @@
 #include <functional>
 
 #include <QQmlExtensionPlugin>
-#include <QTimer>
+#include <QElapsedTimer>
+#include <QHash>
 
 class MprisPlugin : public QQmlExtensionPlugin
 {
@@ -33,6 +34,28 @@ public:
     void registerTypes(const char *uri) override;
 };
 
+// Tracks the org.mpris.MediaPlayer2.* names on the session bus and the pids
+// of their owners, shared by all the Mpris objects.
+class MprisRegistry : public QObject
+{
+    Q_OBJECT
+public:
+    static MprisRegistry *instance();
+
+    QString service(quint64 pid) const;
+
+signals:
+    void playerAdded(const QString &service, quint64 pid);
+    void playerRemoved(const QString &service);
+
+private:
+    MprisRegistry();
+    void ownerChanged(const QString &name, const QString &oldOwner, const QString &newOwner);
+    void addPlayer(const QString &name);
+
+    QHash<QString, quint64> m_players;
+};
+
 class Mpris : public QObject
 {
     Q_PROPERTY(bool valid READ isValid NOTIFY validChanged)
@@ -41,6 +64,7 @@ class Mpris : public QObject
     Q_PROPERTY(QString trackTitle READ trackTitle NOTIFY trackTitleChanged)
     Q_PROPERTY(quint32 trackLength READ trackLength NOTIFY trackLengthChanged)
     Q_PROPERTY(quint32 trackPosition READ trackPosition NOTIFY trackPositionChanged)
+    Q_PROPERTY(int positionUpdateInterval READ positionUpdateInterval WRITE setPositionUpdateInterval NOTIFY positionUpdateIntervalChanged)
     Q_OBJECT
 public:
     enum class PlaybackStatus {
@@ -60,6 +84,10 @@ public:
     inline QString trackTitle() const { return m_trackTitle; }
     inline quint32 trackLength() const { return m_trackLength; }
     quint32 trackPosition() const;
+    // trackPositionChanged() is emitted this often while playing, or never if 0.
+    // The position is computed when read, so this is only needed to animate it.
+    int positionUpdateInterval() const { return m_positionUpdateInterval; }
+    void setPositionUpdateInterval(int interval);
 
 public slots:
     void playPause();
@@ -74,15 +102,21 @@ signals:
     void trackTitleChanged();
     void trackLengthChanged();
     void trackPositionChanged();
+    void positionUpdateIntervalChanged();
     void rateChanged();
 
+protected:
+    void connectNotify(const QMetaMethod &signal) override;
+    void disconnectNotify(const QMetaMethod &signal) override;
+
 private slots:
     void propertiesChanged(const QString &service, const QMap<QString, QVariant> &, const QStringList &);
     void seeked(qint64 time);
 
 private:
     void checkConnection();
-    void checkServices(const QStringList &services);
+    void playerAdded(const QString &service, quint64 pid);
+    void playerRemoved(const QString &service);
     void checkService(const QString &service);
     void setValid(bool v);
     void getProperty(const QString &property, const std::function<void (const QVariant &v)> &func);
@@ -93,7 +127,8 @@ private:
     void getRate();
     void updateRate(double rate);
     void getPosition();
-    void updatePos();
+    void setPosition(qint64 position);
+    void updatePositionTimer();
 
     bool m_valid;
     quint64 m_pid;
@@ -101,9 +136,12 @@ private:
     PlaybackStatus m_playbackStatus;
     QString m_trackTitle;
     quint32 m_trackLength;
-    quint32 m_trackPosition;
+    // the position at the time m_positionTime was started
+    qint64 m_trackPosition;
+    QElapsedTimer m_positionTime;
     double m_rate;
-    QTimer m_posTimer;
+    int m_positionUpdateInterval;
+    int m_positionTimer;
 };
 
 #endif
@@ -100,13 +100,12 @@ inline bool hasHint(const QVariantMap &hints, QString &hint)
 uint NotificationsAdaptor::Notify(const QString &app_name, uint id, const QString &icon, const QString &summary, const QString &body, const QStringList &actions, const QVariantMap &hints, int timeout)
 {
     // handle method call org.freedesktop.Notifications.Notify
-    static uint return_id = 0;
-
     Notification *notification = new Notification;
-    notification->setId(++return_id);
+    notification->setAppName(app_name);
     notification->setBody(body);
     notification->setSummary(summary);
     notification->setIconName(icon);
+    notification->setTimeout(timeout);
 
     QString hint;
     if (hasHint(hints, hint, QStringLiteral("image-data"), QStringLiteral("image_data"))) {
@@ -117,7 +116,6 @@ uint NotificationsAdaptor::Notify(const QString &app_name, uint id, const QStrin
         notification->setIconImage(QPixmap::fromImage(image));
     }
 
-    m_service->newNotification(notification);
-    return return_id;
+    return m_service->newNotification(notification, id);
 }
 
@@ -35,20 +35,32 @@ void NotificationsPlugin::registerTypes(const char *uri)
 }
 
 
+// How long a notification stays on screen, if the application does not say otherwise
+static const int ExpireTimeout = 5000;
+// At most this many notifications are on screen at the same time, and this many wait for a slot
+static const int MaxVisible = 5;
+static const int MaxQueued = 20;
+// Each application can burst this many notifications, and then RateLimit per second
+static const double RateBurst = 10;
+static const double RateLimit = 2;
+
 Notification::Notification()
             : QObject()
+            , m_id(0)
+            , m_timeout(-1)
+            , m_count(1)
+            , m_deadline(0)
 {
 }
 
-void Notification::timerEvent(QTimerEvent *e)
+void Notification::setId(int id)
 {
-    emit expired();
-    deleteLater();
+    m_id = id;
 }
 
-void Notification::setId(int id)
+void Notification::setAppName(const QString &name)
 {
-    m_id = id;
+    m_appName = name;
 }
 
 void Notification::setSummary(const QString &s)
@@ -71,11 +83,21 @@ void Notification::setIconImage(const QPixmap &img)
     m_iconImage = img;
 }
 
+void Notification::setTimeout(int timeout)
+{
+    m_timeout = timeout;
+}
+
 
 
 NotificationsManager::NotificationsManager(QObject *p)
                     : QObject(p)
+                    , m_lastId(0)
 {
+    m_clock.start();
+    m_expiryTimer.setSingleShot(true);
+    connect(&m_expiryTimer, &QTimer::timeout, this, &NotificationsManager::expireNotifications);
+
     static const QString notificationsService = QStringLiteral("org.freedesktop.Notifications");
     QStringList caps = { QStringLiteral("actions"), QStringLiteral("action-icons"), QStringLiteral("body-markup") };
     new NotificationsAdaptor(this, caps);
@@ -97,16 +119,174 @@ NotificationsManager::~NotificationsManager()
 
 }
 
-void NotificationsManager::newNotification(Notification *n)
+uint NotificationsManager::newNotification(Notification *n, uint replacesId)
+{
+    App &app = m_apps[n->appName()];
+    app.received++;
+
+    // An update to a notification we still have, or the same summary sent again
+    // while it is still around: bump the existing one instead of adding a new one.
+    if (Notification *existing = m_notifications.value(replacesId)) {
+        if (update(existing, n, false)) {
+            app.coalesced++;
+            return existing->id();
+        }
+    }
+    foreach (Notification *existing, m_notifications) {
+        if (update(existing, n, true)) {
+            app.coalesced++;
+            return existing->id();
+        }
+    }
+
+    n->setId(++m_lastId);
+    if (!allow(app)) {
+        if (app.dropped++ == 0) {
+            qWarning("Application \"%s\" is sending too many notifications, dropping them.", qPrintable(n->appName()));
+        }
+        uint id = n->id();
+        delete n;
+        return id;
+    }
+
+    m_notifications.insert(n->id(), n);
+    if (m_visible.count() < MaxVisible) {
+        show(n);
+    } else {
+        m_queue << n;
+        if (m_queue.count() > MaxQueued) {
+            Notification *old = m_queue.takeFirst();
+            m_apps[old->appName()].dropped++;
+            expire(old, 1);
+        }
+    }
+    return n->id();
+}
+
+bool NotificationsManager::update(Notification *existing, Notification *n, bool increaseCount)
+{
+    if (existing->appName() != n->appName() || (increaseCount && existing->summary() != n->summary())) {
+        return false;
+    }
+
+    bool iconChanged = existing->iconName() != n->iconName() || !existing->iconImage().isNull() || !n->iconImage().isNull();
+    existing->setSummary(n->summary());
+    existing->setBody(n->body());
+    existing->setIconName(n->iconName());
+    existing->setIconImage(n->iconImage());
+    existing->setTimeout(n->timeout());
+    if (increaseCount) {
+        existing->m_count++;
+    }
+    delete n;
+    emit existing->updated();
+    if (iconChanged) {
+        emit existing->iconChanged();
+    }
+    if (m_visible.contains(existing)) {
+        schedule(existing);
+    }
+    return true;
+}
+
+bool NotificationsManager::allow(App &app)
+{
+    // token bucket
+    qint64 now = m_clock.elapsed();
+    if (app.lastRefill < 0) {
+        app.tokens = RateBurst;
+    } else {
+        app.tokens = qMin(RateBurst, app.tokens + (now - app.lastRefill) * RateLimit / 1000.);
+    }
+    app.lastRefill = now;
+
+    if (app.tokens < 1) {
+        return false;
+    }
+    app.tokens -= 1;
+    return true;
+}
+
+void NotificationsManager::show(Notification *n)
 {
-    int id = n->id();
-    m_notifications[id] = n;
-    n->startTimer(5000);
-    connect(n, &Notification::expired, [this, id]() { m_notifications.remove(id); });
+    m_visible << n;
+    schedule(n);
     emit notify(n);
 }
 
+void NotificationsManager::schedule(Notification *n)
+{
+    if (n->m_deadline) {
+        m_deadlines.remove(n->m_deadline, n->id());
+    }
+    // +1, so that 0 can mean "not scheduled"
+    // 0 would mean never, but a notification can't hold a slot forever
+    n->m_deadline = m_clock.elapsed() + (n->m_timeout > 0 ? n->m_timeout : ExpireTimeout) + 1;
+    m_deadlines.insert(n->m_deadline, n->id());
+
+    qint64 first = m_deadlines.firstKey();
+    if (!m_expiryTimer.isActive() || first == n->m_deadline) {
+        m_expiryTimer.start(qMax<qint64>(0, first - m_clock.elapsed()));
+    }
+}
+
+void NotificationsManager::expire(Notification *n, uint reason)
+{
+    m_notifications.remove(n->id());
+    m_visible.removeOne(n);
+    m_queue.removeOne(n);
+    if (n->m_deadline) {
+        m_deadlines.remove(n->m_deadline, n->id());
+    }
+
+    emit n->expired();
+    emit NotificationClosed(n->id(), reason);
+    n->deleteLater();
+
+    while (m_visible.count() < MaxVisible && !m_queue.isEmpty()) {
+        show(m_queue.takeFirst());
+    }
+}
+
+void NotificationsManager::expireNotifications()
+{
+    qint64 now = m_clock.elapsed();
+    while (!m_deadlines.isEmpty() && m_deadlines.firstKey() <= now) {
+        int id = m_deadlines.first();
+        Notification *n = m_notifications.value(id);
+        m_deadlines.erase(m_deadlines.begin());
+        if (n) {
+            n->m_deadline = 0;
+            expire(n, 1);
+        }
+    }
+
+    if (!m_deadlines.isEmpty()) {
+        m_expiryTimer.start(qMax<qint64>(0, m_deadlines.firstKey() - now));
+    }
+}
+
+void NotificationsManager::CloseNotification(uint id)
+{
+    if (Notification *n = m_notifications.value(id)) {
+        expire(n, 3);
+    }
+}
+
 Notification *NotificationsManager::notification(int id) const
 {
     return m_notifications.value(id);
 }
+
+QVariantMap NotificationsManager::statistics() const
+{
+    QVariantMap stats;
+    for (auto i = m_apps.constBegin(); i != m_apps.constEnd(); ++i) {
+        QVariantMap app;
+        app.insert(QStringLiteral("received"), i->received);
+        app.insert(QStringLiteral("coalesced"), i->coalesced);
+        app.insert(QStringLiteral("dropped"), i->dropped);
+        stats.insert(i.key(), app);
+    }
+    return stats;
+}
@@ -23,6 +23,9 @@
 #include <QDBusAbstractAdaptor>
 #include <QPixmap>
 #include <QQmlExtensionPlugin>
+#include <QMultiMap>
+#include <QTimer>
+#include <QElapsedTimer>
 
 class NotificationsPlugin : public QQmlExtensionPlugin
 {
@@ -36,36 +39,50 @@ class Notification : public QObject
 {
     Q_OBJECT
     Q_PROPERTY(int id READ id CONSTANT)
-    Q_PROPERTY(QString summary READ summary CONSTANT)
-    Q_PROPERTY(QString body READ body CONSTANT)
+    Q_PROPERTY(QString appName READ appName CONSTANT)
+    Q_PROPERTY(QString summary READ summary NOTIFY updated)
+    Q_PROPERTY(QString body READ body NOTIFY updated)
+    Q_PROPERTY(int count READ count NOTIFY updated)
 
 public:
     Notification();
 
     int id() const { return m_id; }
+    QString appName() const { return m_appName; }
     QString summary() const { return m_summary; }
     QString body() const { return m_body; }
     QString iconName() const { return m_iconName; }
     QPixmap iconImage() const { return m_iconImage; }
+    // The timeout requested by the application in ms, or -1 for the default
+    int timeout() const { return m_timeout; }
+    // How many notifications were merged in this one
+    int count() const { return m_count; }
 
     void setId(int id);
+    void setAppName(const QString &name);
     void setSummary(const QString &s);
     void setBody(const QString &body);
     void setIconName(const QString &icon);
     void setIconImage(const QPixmap &img);
-
-protected:
-    void timerEvent(QTimerEvent *e);
+    void setTimeout(int timeout);
 
 signals:
+    void updated();
+    void iconChanged();
     void expired();
 
 private:
     int m_id;
+    QString m_appName;
     QString m_summary;
     QString m_body;
     QString m_iconName;
     QPixmap m_iconImage;
+    int m_timeout;
+    int m_count;
+    qint64 m_deadline;
+
+    friend class NotificationsManager;
 };
 
 class NotificationsManager : public QObject
@@ -75,15 +92,45 @@ public:
     NotificationsManager(QObject *p = nullptr);
     ~NotificationsManager();
 
-    void newNotification(Notification *notification);
+    uint newNotification(Notification *notification, uint replacesId);
 
     Notification *notification(int id) const;
 
+    // Per application counters: { "app": { "received": n, "coalesced": n, "dropped": n } }
+    Q_INVOKABLE QVariantMap statistics() const;
+
+public slots:
+    void CloseNotification(uint id);
+
 signals:
     void notify(Notification *notification);
+    void NotificationClosed(uint id, uint reason);
 
 private:
+    struct App {
+        double tokens = 0;
+        qint64 lastRefill = -1;
+        int received = 0;
+        int coalesced = 0;
+        int dropped = 0;
+    };
+    bool allow(App &app);
+    bool update(Notification *existing, Notification *n, bool increaseCount);
+    void show(Notification *n);
+    void schedule(Notification *n);
+    void expire(Notification *n, uint reason);
+    void expireNotifications();
+
+    // the notifications currently on screen, and the ones waiting for a free slot
     QHash<int, Notification *> m_notifications;
+    QList<Notification *> m_visible;
+    QList<Notification *> m_queue;
+    QHash<QString, App> m_apps;
+    // all the visible notifications share a single timer, armed for the first deadline
+    QMultiMap<qint64, int> m_deadlines;
+    QTimer m_expiryTimer;
+    QElapsedTimer m_clock;
+    uint m_lastId;
 };
 
 #endif
@@ -25,6 +25,7 @@
 #include <QDBusServiceWatcher>
 #include <QDBusMetaType>
 #include <QPoint>
+#include <QtEndian>
 #include <QDebug>
 
 #include "statusnotifieritem.h"
@@ -68,52 +69,35 @@ const QDBusArgument &operator>>(const QDBusArgument &argument, DBusToolTipStruct
     return argument;
 }
 
-static void getProperty(const QString service, const QString property, std::function<void (const QVariant &)> func)
-{
-    DBusInterface iface(service, PATH, QStringLiteral("org.freedesktop.DBus.Properties"), QDBusConnection::sessionBus());
-
-    QDBusPendingCall call = iface.asyncCall(QStringLiteral("Get"), INTERFACE, property);
-    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(call);
-    watcher->connect(watcher, &QDBusPendingCallWatcher::finished, [func, property](QDBusPendingCallWatcher *watcher) {
-        watcher->deleteLater();
-        QDBusPendingReply<QVariant> reply = *watcher;
-        if (reply.isError()) {
-            qDebug() << "Error retrieving" << property << reply.error().message();
-        } else {
-            func(reply.value());
-        }
-    });
-}
+// Apps animating their icon can send NewIcon many times per second,
+// don't refetch more often than this.
+static const int MinRefreshInterval = 250;
 
 StatusNotifierItem::StatusNotifierItem(const QString &service, QObject *p)
                   : QObject(p)
                   , m_service(service)
+                  , m_status(Status::Passive)
                   , m_interface(m_service, PATH, INTERFACE, QDBusConnection::sessionBus())
+                  , m_fetching(false)
+                  , m_refetch(false)
 {
     qDBusRegisterMetaType<DBusImageStruct>();
     qDBusRegisterMetaType<DBusToolTipStruct>();
 
+    m_refreshTimer.setSingleShot(true);
+    connect(&m_refreshTimer, &QTimer::timeout, this, &StatusNotifierItem::fetch);
+
     QDBusConnection bus = QDBusConnection::sessionBus();
     QDBusServiceWatcher *watcher = new QDBusServiceWatcher(service, bus, QDBusServiceWatcher::WatchForUnregistration, this);
     connect(watcher, &QDBusServiceWatcher::serviceUnregistered, this, &StatusNotifierItem::removed);
-    bus.connect(service, PATH, INTERFACE, QStringLiteral("NewTitle"), this, SLOT(getTitle()));
-    bus.connect(service, PATH, INTERFACE, QStringLiteral("NewIcon"), this, SLOT(getIcon()));
-    bus.connect(service, PATH, INTERFACE, QStringLiteral("NewAttentionIcon"), this, SLOT(getAttentionIcon()));
-    bus.connect(service, PATH, INTERFACE, QStringLiteral("NewToolTip"), this, SLOT(getTooltip()));
-    bus.connect(service, PATH, INTERFACE, QStringLiteral("NewStatus"), this, SLOT(getStatus()));
-
-    m_icon.updatePending = 0;
-    m_attentionIcon.updatePending = 0;
-
-    getProperty(m_service, QStringLiteral("Id"), [this](const QVariant &v) {
-        m_name = v.toString();
-        emit nameChanged();
-    });
-    getIcon();
-    getTitle();
-    getTooltip();
-    getStatus();
-    getAttentionIcon();
+    // All the properties are fetched with a single GetAll call, whatever changed
+    bus.connect(service, PATH, INTERFACE, QStringLiteral("NewTitle"), this, SLOT(refresh()));
+    bus.connect(service, PATH, INTERFACE, QStringLiteral("NewIcon"), this, SLOT(refresh()));
+    bus.connect(service, PATH, INTERFACE, QStringLiteral("NewAttentionIcon"), this, SLOT(refresh()));
+    bus.connect(service, PATH, INTERFACE, QStringLiteral("NewToolTip"), this, SLOT(refresh()));
+    bus.connect(service, PATH, INTERFACE, QStringLiteral("NewStatus"), this, SLOT(refresh()));
+
+    fetch();
 }
 
 StatusNotifierItem::~StatusNotifierItem()
@@ -140,11 +124,39 @@ QString StatusNotifierItem::iconName() const
     return m_icon.name;
 }
 
-static QPixmap pixmap(const QSize &s, const DBusImageVector &vec)
+// The pixmaps are ARGB32 in network byte order, while QImage wants them in
+// the host order. qFromBigEndian() swaps whole arrays with SIMD when it can.
+static QImage convertImage(const DBusImageStruct &image)
+{
+    if (image.width <= 0 || image.height <= 0 || image.data.size() < image.width * image.height * 4) {
+        return QImage();
+    }
+
+    QImage img(image.width, image.height, QImage::Format_ARGB32);
+    const int count = image.width * image.height;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
+    qFromBigEndian<quint32>(image.data.constData(), count, img.bits());
+#else
+    const uchar *src = reinterpret_cast<const uchar *>(image.data.constData());
+    quint32 *dst = reinterpret_cast<quint32 *>(img.bits());
+    for (int i = 0; i < count; ++i) {
+        dst[i] = qFromBigEndian<quint32>(src + i * 4);
+    }
+#endif
+    return img;
+}
+
+QPixmap StatusNotifierItem::pixmap(const Icon &icon, const QSize &s) const
 {
+    quint64 key = (quint64)s.width() << 32 | (quint32)s.height();
+    auto it = icon.cache.constFind(key);
+    if (it != icon.cache.constEnd()) {
+        return *it;
+    }
+
     const DBusImageStruct *image = nullptr;
     int dw, dh;
-    foreach (const DBusImageStruct &img, vec) {
+    foreach (const DBusImageStruct &img, icon.pixmap) {
         int _dw = qAbs(img.width - s.width());
         int _dh = qAbs(img.height - s.height());
         if (!image || _dw < dw || _dh < dh) {
@@ -153,16 +165,17 @@ static QPixmap pixmap(const QSize &s, const DBusImageVector &vec)
             dh = _dh;
         }
     }
+    QPixmap pix;
     if (image) {
-        QImage img((const uchar *)image->data.constData(), image->width, image->height, QImage::Format_ARGB32);
-        return QPixmap::fromImage(img);
+        pix = QPixmap::fromImage(convertImage(*image));
     }
-    return QPixmap();
+    icon.cache.insert(key, pix);
+    return pix;
 }
 
 QPixmap StatusNotifierItem::iconPixmap(const QSize &s) const
 {
-    return pixmap(s, m_icon.pixmap);
+    return pixmap(m_icon, s);
 }
 
 QString StatusNotifierItem::attentionIconName() const
@@ -172,7 +185,7 @@ QString StatusNotifierItem::attentionIconName() const
 
 QPixmap StatusNotifierItem::attentionIconPixmap(const QSize &s) const
 {
-    return pixmap(s, m_attentionIcon.pixmap);
+    return pixmap(m_attentionIcon, s);
 }
 
 QString StatusNotifierItem::tooltipTitle() const
@@ -206,63 +219,107 @@ void StatusNotifierItem::scroll(const QPoint &delta)
     }
 }
 
-void StatusNotifierItem::getTitle()
+void StatusNotifierItem::refresh()
 {
-    getProperty(m_service, QStringLiteral("Title"), [this](const QVariant &v) {
-        m_title = v.toString();
-        emit titleChanged();
-    });
-}
+    if (m_fetching) {
+        m_refetch = true;
+        return;
+    }
+    if (m_refreshTimer.isActive()) {
+        return;
+    }
 
-void StatusNotifierItem::getIcon()
-{
-    m_icon.updatePending += 2;
-    getProperty(m_service, QStringLiteral("IconName"), [this](const QVariant &v) {
-        m_icon.name = v.toString();
-        if (--m_icon.updatePending == 0)
-            emit iconChanged();
-    });
-    getProperty(m_service, QStringLiteral("IconPixmap"), [this](const QVariant &v) {
-        v.value<QDBusArgument>() >> m_icon.pixmap;
-        if (--m_icon.updatePending == 0)
-            emit iconChanged();
-    });
+    qint64 elapsed = m_lastFetch.isValid() ? m_lastFetch.elapsed() : MinRefreshInterval;
+    m_refreshTimer.start(qMax<qint64>(0, MinRefreshInterval - elapsed));
 }
 
-void StatusNotifierItem::getAttentionIcon()
+void StatusNotifierItem::fetch()
 {
-    m_attentionIcon.updatePending += 2;
-    getProperty(m_service, QStringLiteral("AttentionIconName"), [this](const QVariant &v) {
-        m_attentionIcon.name = v.toString();
-        if (--m_attentionIcon.updatePending)
-            emit attentionIconChanged();
-    });
-    getProperty(m_service, QStringLiteral("AttentionIconPixmap"), [this](const QVariant &v) {
-        v.value<QDBusArgument>() >> m_attentionIcon.pixmap;
-        if (--m_attentionIcon.updatePending)
-            emit attentionIconChanged();
+    m_fetching = true;
+    m_refetch = false;
+    m_lastFetch.start();
+
+    DBusInterface iface(m_service, PATH, QStringLiteral("org.freedesktop.DBus.Properties"), QDBusConnection::sessionBus());
+    QDBusPendingCall call = iface.asyncCall(QStringLiteral("GetAll"), INTERFACE);
+    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(call, this);
+    connect(watcher, &QDBusPendingCallWatcher::finished, [this](QDBusPendingCallWatcher *watcher) {
+        watcher->deleteLater();
+        m_fetching = false;
+        QDBusPendingReply<QVariantMap> reply = *watcher;
+        if (reply.isError()) {
+            qDebug() << "Error retrieving the properties of" << m_service << reply.error().message();
+        } else {
+            update(reply.value());
+        }
+        if (m_refetch) {
+            refresh();
+        }
     });
 }
 
-void StatusNotifierItem::getTooltip()
+bool StatusNotifierItem::updateIcon(Icon &icon, const QVariantMap &properties, const QString &nameProperty, const QString &pixmapProperty)
 {
-    getProperty(m_service, QStringLiteral("ToolTip"), [this](const QVariant &v) {
-        v.value<QDBusArgument>() >> m_tooltip;
-        emit tooltipChanged();
-    });
+    QString name = properties.value(nameProperty).toString();
+    DBusImageVector pixmap;
+    QVariant v = properties.value(pixmapProperty);
+    if (v.canConvert<QDBusArgument>()) {
+        v.value<QDBusArgument>() >> pixmap;
+    }
+
+    bool changed = name != icon.name || pixmap.count() != icon.pixmap.count();
+    for (int i = 0; !changed && i < pixmap.count(); ++i) {
+        const DBusImageStruct &a = pixmap.at(i);
+        const DBusImageStruct &b = icon.pixmap.at(i);
+        changed = a.width != b.width || a.height != b.height || a.data != b.data;
+    }
+    if (changed) {
+        icon.name = name;
+        icon.pixmap = pixmap;
+        icon.cache.clear();
+    }
+    return changed;
 }
 
-void StatusNotifierItem::getStatus()
+void StatusNotifierItem::update(const QVariantMap &properties)
 {
-    getProperty(m_service, QStringLiteral("Status"), [this](const QVariant &v) {
-        QString str = v.toString();
-        if (str == QStringLiteral("NeedsAttention")) {
-            m_status = Status::NeedsAttention;
-        } else if (str == QStringLiteral("Active")) {
-            m_status = Status::Active;
-        } else {
-            m_status = Status::Passive;
+    QString name = properties.value(QStringLiteral("Id")).toString();
+    if (name != m_name) {
+        m_name = name;
+        emit nameChanged();
+    }
+
+    QString title = properties.value(QStringLiteral("Title")).toString();
+    if (title != m_title) {
+        m_title = title;
+        emit titleChanged();
+    }
+
+    if (updateIcon(m_icon, properties, QStringLiteral("IconName"), QStringLiteral("IconPixmap"))) {
+        emit iconChanged();
+    }
+    if (updateIcon(m_attentionIcon, properties, QStringLiteral("AttentionIconName"), QStringLiteral("AttentionIconPixmap"))) {
+        emit attentionIconChanged();
+    }
+
+    QVariant tooltip = properties.value(QStringLiteral("ToolTip"));
+    if (tooltip.canConvert<QDBusArgument>()) {
+        DBusToolTipStruct t;
+        tooltip.value<QDBusArgument>() >> t;
+        if (!(t == m_tooltip)) {
+            m_tooltip = t;
+            emit tooltipChanged();
         }
+    }
+
+    QString str = properties.value(QStringLiteral("Status")).toString();
+    Status status = Status::Passive;
+    if (str == QStringLiteral("NeedsAttention")) {
+        status = Status::NeedsAttention;
+    } else if (str == QStringLiteral("Active")) {
+        status = Status::Active;
+    }
+    if (status != m_status) {
+        m_status = status;
         emit statusChanged();
-    });
+    }
 }
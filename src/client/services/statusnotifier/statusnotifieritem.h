@@ -23,6 +23,9 @@
 #include <QObject>
 #include <QVector>
 #include <QPixmap>
+#include <QHash>
+#include <QTimer>
+#include <QElapsedTimer>
 
 #include "dbusinterface.h"
 
@@ -33,6 +36,11 @@ struct DBusImageStruct {
     QByteArray data;
 };
 
+inline bool operator==(const DBusImageStruct &a, const DBusImageStruct &b)
+{
+    return a.width == b.width && a.height == b.height && a.data == b.data;
+}
+
 typedef QVector<DBusImageStruct> DBusImageVector;
 
 struct DBusToolTipStruct {
@@ -42,6 +50,11 @@ struct DBusToolTipStruct {
     QString subTitle;
 };
 
+inline bool operator==(const DBusToolTipStruct &a, const DBusToolTipStruct &b)
+{
+    return a.icon == b.icon && a.image == b.image && a.title == b.title && a.subTitle == b.subTitle;
+}
+
 class StatusNotifierItem: public QObject
 {
     Q_OBJECT
@@ -85,17 +98,20 @@ signals:
     void statusChanged();
 
 private slots:
-    void getTitle();
-    void getIcon();
-    void getAttentionIcon();
-    void getTooltip();
-    void getStatus();
+    void refresh();
+
 private:
     struct Icon {
         QString name;
         DBusImageVector pixmap;
-        int updatePending;
+        // converted pixmaps by requested size, cleared when the icon changes
+        mutable QHash<quint64, QPixmap> cache;
     };
+    void fetch();
+    void update(const QVariantMap &properties);
+    bool updateIcon(Icon &icon, const QVariantMap &properties, const QString &nameProperty, const QString &pixmapProperty);
+    QPixmap pixmap(const Icon &icon, const QSize &size) const;
+
     QString m_service;
     QString m_name;
     QString m_title;
@@ -104,6 +120,10 @@ private:
     DBusToolTipStruct m_tooltip;
     Status m_status;
     DBusInterface m_interface;
+    QTimer m_refreshTimer;
+    QElapsedTimer m_lastFetch;
+    bool m_fetching;
+    bool m_refetch;
 };
 
 #endif
@@ -42,6 +42,7 @@
 #include "style.h"
 #include "compositorsettings.h"
 #include "keysequence.h"
+#include "notification.h"
 
 const char *defaultShell =
 "{\n"
@@ -125,6 +126,7 @@ ShellUI::ShellUI(Client *client, CompositorSettings *s, QQmlEngine *engine, cons
 ShellUI::~ShellUI()
 {
     qDeleteAll(m_screens);
+    qDeleteAll(m_styles);
 }
 
 UiScreen *ShellUI::loadScreen(QScreen *sc, const QString &name)
@@ -201,8 +203,15 @@ void ShellUI::setStyleName(const QString &name)
         return;
     }
 
-    delete m_style;
-    m_style = Style::loadStyle(name, m_engine);
+    // The styles already used are kept around, switching back to one reuses its
+    // components. The items of the old style also stay valid until they are swapped.
+    m_style = m_styles.value(name);
+    if (!m_style) {
+        m_style = Style::loadStyle(name, m_engine);
+        if (m_style) {
+            m_styles.insert(name, m_style);
+        }
+    }
     m_styleName = name;
     m_engine->rootContext()->setContextProperty(QStringLiteral("CurrentStyle"), m_style);
 }
@@ -260,6 +269,11 @@ void ShellUI::reloadConfig()
         }
     }
 
+    QJsonObject notifications = m_config[QStringLiteral("Notifications")].toObject();
+    NotificationWindow::configurePool(notifications[QStringLiteral("poolSize")].toInt(4),
+                                      notifications[QStringLiteral("prewarm")].toInt(1),
+                                      notifications[QStringLiteral("idleTrimTimeout")].toInt(60) * 1000);
+
     foreach (UiScreen *screen, m_screens) {
         loadScreen(screen);
     }
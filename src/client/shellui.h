@@ -22,6 +22,7 @@
 
 #include <QObject>
 #include <QStringList>
+#include <QHash>
 #include <QJsonDocument>
 #include <QJsonObject>
 
@@ -99,6 +100,7 @@ private:
     int m_numWorkspaces;
     QString m_styleName;
     Style *m_style;
+    QHash<QString, Style *> m_styles;
     QList<Binding *> m_bindings;
 
     QStringList m_properties;
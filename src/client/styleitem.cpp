@@ -20,14 +20,22 @@
 #include <QQmlComponent>
 #include <QtQml>
 #include <QDebug>
+#include <QTimer>
+#include <QElapsedTimer>
 
 #include "styleitem.h"
 
 static const int a = qmlRegisterType<StyleItem>("Orbital", 1, 0, "StyleItem");
 static const int b = qmlRegisterType<StyleComponent>("Orbital", 1, 0, "StyleComponent");
 
+// The items waiting for their new style to be instantiated
+static QList<StyleItem *> s_pending;
+// How long to spend swapping styles before giving a frame a chance
+static const int PendingBudget = 8;
+
 StyleItem::StyleItem(QQuickItem *p)
          : QQuickItem(p)
+         , m_element(nullptr)
          , m_component(nullptr)
          , m_item(nullptr)
          , m_acceptChildren(false)
@@ -37,21 +45,59 @@ StyleItem::StyleItem(QQuickItem *p)
     m_acceptChildren = true;
 }
 
+StyleItem::~StyleItem()
+{
+    s_pending.removeOne(this);
+    if (m_element) {
+        m_element->m_styleItems.removeOne(this);
+    }
+}
+
 void StyleItem::setComponent(QQmlComponent *c)
+{
+    if (c == m_component) {
+        return;
+    }
+
+    m_component = c;
+    // The first item is created right away, the bindings on it need it. When the
+    // style changes the items are swapped a batch at a time instead, keeping the
+    // old ones until then.
+    if (!m_item || !c) {
+        s_pending.removeOne(this);
+        createItem();
+    } else if (!s_pending.contains(this)) {
+        if (s_pending.isEmpty()) {
+            QTimer::singleShot(0, &StyleItem::createPendingItems);
+        }
+        s_pending << this;
+    }
+}
+
+void StyleItem::createPendingItems()
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (!s_pending.isEmpty() && timer.elapsed() < PendingBudget) {
+        s_pending.takeFirst()->createItem();
+    }
+    if (!s_pending.isEmpty()) {
+        QTimer::singleShot(0, &StyleItem::createPendingItems);
+    }
+}
+
+void StyleItem::createItem()
 {
     QQuickItem *old = m_item;
 
     Element::Location loc = Element::Location::Floating;
     if (m_item) {
         loc = m_item->m_location;
-    } else {
-        Element *e = Element::fromItem(parentItem());
-        if (e) {
-            loc = e->location();
-        }
+    } else if (Element *e = m_element ? m_element : Element::fromItem(parentItem())) {
+        loc = e->location();
     }
 
-    m_component = c;
+    QQmlComponent *c = m_component;
     m_item = nullptr;
     if (c) {
         QObject *obj = c->beginCreate(c->creationContext());
@@ -82,10 +128,46 @@ void StyleItem::setComponent(QQmlComponent *c)
     updateMargins();
 }
 
+void StyleItem::componentComplete()
+{
+    QQuickItem::componentComplete();
+    updateElement();
+}
+
+// Keeps the item registered in the nearest element, so that it can update
+// the location without looking for the style items in the whole tree
+void StyleItem::updateElement()
+{
+    Element *element = nullptr;
+    QObject *o = parentItem();
+    if (!o) {
+        o = parent();
+    }
+    while (o && !element) {
+        element = qobject_cast<Element *>(o);
+        QQuickItem *item = qobject_cast<QQuickItem *>(o);
+        o = item && item->parentItem() ? item->parentItem() : o->parent();
+    }
+
+    if (element == m_element) {
+        return;
+    }
+    if (m_element) {
+        m_element->m_styleItems.removeOne(this);
+    }
+    m_element = element;
+    if (m_element) {
+        m_element->m_styleItems << this;
+        updateLocation(m_element->location());
+    }
+}
+
 void StyleItem::itemChange(ItemChange change, const ItemChangeData &value)
 {
     if (m_acceptChildren && change == QQuickItem::ItemChildAddedChange && value.item != m_child && value.item != m_item) {
         value.item->setParentItem(m_child);
+    } else if (change == QQuickItem::ItemParentHasChanged && isComponentComplete()) {
+        updateElement();
     }
 
     QQuickItem::itemChange(change, value);
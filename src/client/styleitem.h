@@ -69,6 +69,7 @@ class StyleItem : public QQuickItem
     Q_PROPERTY(QQuickItem *item READ item NOTIFY itemChanged)
 public:
     StyleItem(QQuickItem *p = nullptr);
+    ~StyleItem();
 
     QQmlComponent *component() const { return m_component; }
     void setComponent(QQmlComponent *c);
@@ -77,6 +78,7 @@ public:
     void updateLocation(Element::Location loc);
 
 protected:
+    virtual void componentComplete() override;
     virtual void itemChange(ItemChange change, const ItemChangeData &value) override;
     virtual void geometryChanged(const QRectF &newGeometry, const QRectF &oldGeometry) override;
 
@@ -85,7 +87,11 @@ signals:
 
 private:
     void updateMargins();
+    void createItem();
+    void updateElement();
+    static void createPendingItems();
 
+    Element *m_element;
     QQmlComponent *m_component;
     StyleComponent *m_item;
     bool m_acceptChildren;
@@ -29,6 +29,7 @@
 #include <QScreen>
 #include <QTimer>
 #include <QJsonArray>
+#include <QQmlIncubator>
 
 #include "client.h"
 #include "element.h"
@@ -42,116 +43,234 @@ UiScreen::UiScreen(ShellUI *ui, Client *client, QScreen *screen, const QString &
        , m_name(name)
        , m_screen(screen)
        , m_loading(true)
+       , m_incubator(nullptr)
+       , m_sharedWindow(nullptr)
+       , m_renderStats(std::make_shared<RenderStats>())
 {
 }
 
 UiScreen::~UiScreen()
 {
+    cancelJobs();
     qDeleteAll(m_children);
+    delete m_sharedWindow;
+}
+
+class ElementIncubator : public QQmlIncubator
+{
+public:
+    ElementIncubator(UiScreen *s) : QQmlIncubator(Asynchronous), screen(s) {}
+
+    void setInitialState(QObject *obj) override
+    {
+        screen->initElement(obj);
+    }
+    void statusChanged(Status status) override
+    {
+        // don't go on from inside the incubator, it may not be safe to delete it here
+        if (status == Ready || status == Error) {
+            QMetaObject::invokeMethod(screen, "incubated", Qt::QueuedConnection);
+        }
+    }
+
+    UiScreen *screen;
+};
+
+static int elementPriority(const QJsonObject &config)
+{
+    ElementInfo *info = Element::elementsInfo().value(config[QStringLiteral("type")].toString());
+    if (!info) {
+        return 2;
+    }
+    switch (info->type()) {
+        case ElementInfo::Type::Background:
+            return 0;
+        case ElementInfo::Type::Panel:
+        // the lock screen must be ready before the first lock, which may come any time
+        case ElementInfo::Type::LockScreen:
+            return 1;
+        default:
+            return 2;
+    }
 }
 
 void UiScreen::loadConfig(QJsonObject &config)
 {
+    cancelJobs();
+
     foreach (Element *elm, m_elements) {
         if (elm->m_parent) {
             elm->setParentElement(nullptr);
         }
     }
 
-    QHash<int, Element *> oldElements = m_elements;
+    // A previous load may still have old elements left to reuse or delete
+    for (auto i = m_elements.constBegin(); i != m_elements.constEnd(); ++i) {
+        m_oldElements.insert(i.key(), i.value());
+    }
     m_elements.clear();
 
+    // The elements are created asynchronously, but the config needs the
+    // ids of the new ones right away
     QJsonArray elements = config[QStringLiteral("elements")].toArray();
     for (auto i = elements.begin(); i != elements.end(); ++i) {
         QJsonObject element = (*i).toObject();
-        Element *elm = loadElement(nullptr, element, &oldElements);
-        if (elm) {
-            elm->setParent(this);
-            m_children << elm;
+        if (element.contains(QStringLiteral("type"))) {
+            assignIds(element);
+            addJob(nullptr, true, element, elementPriority(element));
         }
         *i = element;
     }
     config[QStringLiteral("elements")] = elements;
+    m_loadedElements = elements;
+
+    m_elementTimer.start();
+    runJobs();
+}
 
-    foreach (Element *e, oldElements) {
-        e->deleteLater();
-        m_children.removeOne(e);
+void UiScreen::assignIds(QJsonObject &config)
+{
+    if (config.contains(QStringLiteral("id"))) {
+        int id = config[QStringLiteral("id")].toInt();
+        if (id >= Element::s_id) {
+            Element::s_id = id + 1;
+        }
+    } else {
+        config[QStringLiteral("id")] = Element::s_id++;
     }
 
-    foreach (Element *elm, m_children) {
-        if (elm->type() == ElementInfo::Type::Item)
+    QJsonArray children = config[QStringLiteral("elements")].toArray();
+    for (auto i = children.begin(); i != children.end(); ++i) {
+        QJsonObject cfg = (*i).toObject();
+        if (cfg.contains(QStringLiteral("type"))) {
+            assignIds(cfg);
+        }
+        *i = cfg;
+    }
+    config[QStringLiteral("elements")] = children;
+}
+
+void UiScreen::addJob(Element *parent, bool topLevel, const QJsonObject &config, int priority)
+{
+    // Keep the queue sorted, and FIFO among the same priority
+    int i = m_jobs.count();
+    while (i > 0 && m_jobs.at(i - 1).priority > priority) {
+        --i;
+    }
+    m_jobs.insert(i, Job{ parent, topLevel, config, priority });
+}
+
+void UiScreen::cancelJobs()
+{
+    m_jobs.clear();
+    if (m_incubator) {
+        m_incubator->clear();
+        delete m_incubator;
+        m_incubator = nullptr;
+    }
+}
+
+void UiScreen::runJobs()
+{
+    while (!m_incubator && !m_jobs.isEmpty()) {
+        const Job &job = m_jobs.first();
+        if (!job.topLevel && !job.parent) {
+            m_jobs.removeFirst();
             continue;
+        }
 
-        if (elm->type() == ElementInfo::Type::Panel) {
-            Panel *p = static_cast<Panel *>(elm->window());
-            if (!p) {
-                p = new Panel(m_screen, elm);
-            }
-            p->setLocation(elm->location());
-        } else {
-            QQuickWindow *window = m_client->window(elm);
-
-            connect(m_screen, &QObject::destroyed, [window]() { delete window; });
-            connect(elm, &QObject::destroyed, window, &QObject::deleteLater);
-            window->setScreen(m_screen);
-            window->setWidth(elm->width());
-            window->setHeight(elm->height());
-            window->setColor(Qt::transparent);
-            window->setFlags(Qt::BypassWindowManagerHint);
-            window->show();
-            window->create();
-
-            m_client->setInputRegion(window, elm->inputRegion());
-
-            switch (elm->type()) {
-                case ElementInfo::Type::Background:
-                    m_client->setBackground(window, m_screen);
-                    break;
-                case ElementInfo::Type::Panel:
-                    m_client->setPanel(window, m_screen, (int)elm->location());
-                    break;
-                case ElementInfo::Type::Overlay:
-                    m_client->addOverlay(window, m_screen);
-                    break;
-                case ElementInfo::Type::LockScreen:
-                    m_client->setLockScreen(window, m_screen);
-                    break;
-                default:
-                    break;
+        int id = job.config[QStringLiteral("id")].toInt();
+        if (Element *elm = m_oldElements.take(id)) {
+            Job j = m_jobs.takeFirst();
+            elementCreated(j, elm, false);
+            continue;
+        }
+
+        QString type = job.config[QStringLiteral("type")].toString();
+        QQmlComponent *component = Element::component(m_ui->qmlEngine(), type);
+        if (component && component->isLoading()) {
+            connect(component, &QQmlComponent::statusChanged, this, &UiScreen::runJobs, Qt::UniqueConnection);
+            return;
+        }
+
+        m_currentJob = m_jobs.takeFirst();
+        if (!component || !component->isReady()) {
+            if (component) {
+                qWarning() << "Could not load the element" << type;
+                qWarning() << qPrintable(component->errorString());
             }
+            continue;
         }
+
+        disconnect(component, &QQmlComponent::statusChanged, this, &UiScreen::runJobs);
+        m_elementTimer.restart();
+        m_incubator = new ElementIncubator(this);
+        component->create(*m_incubator, m_ui->qmlEngine()->rootContext());
     }
 
-    // wait until all the objects have finished what they're doing before sending the loaded event
-    QTimer::singleShot(0, this, &UiScreen::screenLoaded);
+    if (!m_incubator && m_jobs.isEmpty()) {
+        foreach (Element *e, m_oldElements) {
+            e->deleteLater();
+            m_children.removeOne(e);
+        }
+        m_oldElements.clear();
+
+        // wait until all the objects have finished what they're doing before sending the loaded event
+        QTimer::singleShot(0, this, &UiScreen::screenLoaded);
+    }
 }
 
-Element *UiScreen::loadElement(Element *parent, QJsonObject &config, QHash<int, Element *> *elements)
+void UiScreen::initElement(QObject *obj)
 {
-    if (!config.keys().contains(QStringLiteral("type"))) {
-        return nullptr;
+    if (Element *elm = qobject_cast<Element *>(obj)) {
+        QString type = m_currentJob.config[QStringLiteral("type")].toString();
+        elm->setup(m_ui, this, type, m_currentJob.config[QStringLiteral("id")].toInt());
     }
+}
 
-    bool created = false;
-    int id = config.contains(QStringLiteral("id")) ? config[QStringLiteral("id")].toInt() : -1;
-    Element *elm = (elements ? elements->take(id) : nullptr);
-    if (!elm) {
-        QString type = config[QStringLiteral("type")].toString();
-        elm = Element::create(m_ui, this, m_ui->qmlEngine(), type, id);
+void UiScreen::incubated()
+{
+    if (!m_incubator) {
+        return;
+    }
+
+    QQmlIncubator *incubator = m_incubator;
+    m_incubator = nullptr;
+    QString type = m_currentJob.config[QStringLiteral("type")].toString();
+
+    if (incubator->isError()) {
+        qWarning() << "Could not create the element" << type;
+        foreach (const QQmlError &error, incubator->errors()) {
+            qWarning() << qPrintable(error.toString());
+        }
+    } else {
+        QObject *obj = incubator->object();
+        Element *elm = qobject_cast<Element *>(obj);
         if (!elm) {
-            return nullptr;
+            qWarning() << QStringLiteral("\'%1\' is not an element type.").arg(type);
+            delete obj;
+        } else if (!m_currentJob.topLevel && !m_currentJob.parent) {
+            delete elm;
+        } else {
+            qDebug() << "Creating" << type << "in" << m_elementTimer.elapsed() << "ms.";
+            connect(elm, &QObject::destroyed, this, &UiScreen::elementDestroyed);
+            elementCreated(m_currentJob, elm, true);
         }
-        connect(elm, &QObject::destroyed, this, &UiScreen::elementDestroyed);
-        created = true;
     }
-    if (parent) {
-        elm->setParentElement(parent);
+    delete incubator;
+
+    runJobs();
+}
+
+void UiScreen::elementCreated(const Job &job, Element *elm, bool created)
+{
+    if (job.parent) {
+        elm->setParentElement(job.parent);
     }
     elm->m_properties.clear();
     m_elements.insert(elm->m_id, elm);
-    config[QStringLiteral("id")] = elm->m_id;
 
-    QJsonObject properties = config[QStringLiteral("properties")].toObject();
+    QJsonObject properties = job.config[QStringLiteral("properties")].toObject();
     for (auto i = properties.constBegin(); i != properties.constEnd(); ++i) {
         QString name = i.key();
         QVariant value = i.value().toVariant();
@@ -164,23 +283,155 @@ Element *UiScreen::loadElement(Element *parent, QJsonObject &config, QHash<int,
         elm->addProperty(name);
     }
 
-    QJsonArray children = config[QStringLiteral("elements")].toArray();
-    for (auto i = children.begin(); i != children.end(); ++i) {
+    if (created && job.parent) {
+        job.parent->createConfig(elm);
+        job.parent->createBackground(elm);
+    }
+
+    if (job.topLevel) {
+        elm->setParent(this);
+        if (!m_children.contains(elm)) {
+            m_children << elm;
+        }
+        createWindow(elm);
+    }
+
+    // The children go right after their parent, before the elements with
+    // a lower priority
+    QJsonArray children = job.config[QStringLiteral("elements")].toArray();
+    for (auto i = children.constBegin(); i != children.constEnd(); ++i) {
         QJsonObject cfg = (*i).toObject();
-        loadElement(elm, cfg, elements);
-        *i = cfg;
+        if (cfg.contains(QStringLiteral("type"))) {
+            addJob(elm, false, cfg, job.priority);
+        }
     }
-    config[QStringLiteral("elements")] = children;
 
-    if (created && parent) {
-        parent->createConfig(elm);
-        parent->createBackground(elm);
+    emit elementLoaded(elm);
+}
+
+void UiScreen::createWindow(Element *elm)
+{
+    if (elm->type() == ElementInfo::Type::Item)
+        return;
+
+    if (elm->type() == ElementInfo::Type::Panel) {
+        Panel *p = static_cast<Panel *>(elm->window());
+        if (!p) {
+            p = new Panel(m_screen, elm);
+        }
+        p->setLocation(elm->location());
+        trackWindow(p);
+        return;
+    }
+
+    // The overlays not taking input can all be drawn by a single window,
+    // sharing its scene graph and buffers
+    if (Client::sharedRenderLoop() && elm->type() == ElementInfo::Type::Overlay && elm->inputRegion().isEmpty()) {
+        elm->setParentItem(sharedWindow()->contentItem());
+        return;
+    }
+
+    QQuickWindow *window = m_client->window(elm);
+
+    connect(m_screen, &QObject::destroyed, [window]() { delete window; });
+    connect(elm, &QObject::destroyed, window, &QObject::deleteLater);
+    window->setScreen(m_screen);
+    window->setWidth(elm->width());
+    window->setHeight(elm->height());
+    window->setColor(Qt::transparent);
+    window->setFlags(Qt::BypassWindowManagerHint);
+    window->show();
+    window->create();
+
+    m_client->setInputRegion(window, elm->inputRegion());
+
+    switch (elm->type()) {
+        case ElementInfo::Type::Background:
+            m_client->setBackground(window, m_screen);
+            break;
+        case ElementInfo::Type::Overlay:
+            m_client->addOverlay(window, m_screen);
+            break;
+        case ElementInfo::Type::LockScreen:
+            m_client->setLockScreen(window, m_screen);
+            break;
+        default:
+            break;
+    }
+    trackWindow(window);
+}
+
+QQuickWindow *UiScreen::sharedWindow()
+{
+    if (!m_sharedWindow) {
+        m_sharedWindow = new QQuickWindow;
+        m_sharedWindow->setScreen(m_screen);
+        m_sharedWindow->setWidth(m_screen->size().width());
+        m_sharedWindow->setHeight(m_screen->size().height());
+        m_sharedWindow->setColor(Qt::transparent);
+        m_sharedWindow->setFlags(Qt::BypassWindowManagerHint);
+        m_sharedWindow->show();
+        m_sharedWindow->create();
+
+        m_client->setInputRegion(m_sharedWindow, QRectF());
+        m_client->addOverlay(m_sharedWindow, m_screen);
+        trackWindow(m_sharedWindow);
+    }
+    return m_sharedWindow;
+}
+
+void UiScreen::trackWindow(QQuickWindow *window)
+{
+    // The per frame hooks are not free, only install them when asked to
+    if (!Client::renderStats()) {
+        return;
     }
-    return (created ? elm : nullptr);
+
+    m_windows.removeAll(QPointer<QQuickWindow>());
+    if (m_windows.contains(window)) {
+        return;
+    }
+    m_windows << window;
+
+    // These are emitted in the render thread, which may be a different one for
+    // every window
+    std::shared_ptr<QElapsedTimer> timer = std::make_shared<QElapsedTimer>();
+    std::shared_ptr<RenderStats> stats = m_renderStats;
+    QPointer<UiScreen> screen = this;
+    connect(window, &QQuickWindow::beforeRendering, window, [timer]() { timer->start(); }, Qt::DirectConnection);
+    connect(window, &QQuickWindow::afterRendering, window, [timer, stats, screen]() {
+        stats->time.fetchAndAddRelaxed(timer->nsecsElapsed());
+        if (stats->frames.fetchAndAddRelaxed(1) % 600 == 599 && screen) {
+            QMetaObject::invokeMethod(screen, "reportStats", Qt::QueuedConnection);
+        }
+    }, Qt::DirectConnection);
+}
+
+void UiScreen::reportStats()
+{
+    int windows = 0;
+    qint64 bytes = 0;
+    foreach (const QPointer<QQuickWindow> &w, m_windows) {
+        if (w && w->isVisible()) {
+            // Assume double buffering of ARGB32 buffers
+            QSize size = w->size() * w->devicePixelRatio();
+            bytes += 2 * 4 * size.width() * size.height();
+            ++windows;
+        }
+    }
+    int frames = m_renderStats->frames.fetchAndStoreRelaxed(0);
+    qint64 time = m_renderStats->time.fetchAndStoreRelaxed(0);
+    qDebug("Screen %s: %d windows, ~%lld KiB of buffers, %.2f ms average render time over %d frames.",
+           qPrintable(m_name), windows, bytes / 1024, frames ? time / 1e6 / frames : 0., frames);
 }
 
 void UiScreen::saveConfig(QJsonObject &config)
 {
+    // Saving now would drop the elements that are not created yet
+    if (m_incubator || !m_jobs.isEmpty()) {
+        config[QStringLiteral("elements")] = m_loadedElements;
+        return;
+    }
     saveChildren(m_children, config);
 }
 
@@ -258,6 +509,7 @@ void UiScreen::elementDestroyed(QObject *obj)
     Element *elm = static_cast<Element *>(obj);
     m_children.removeOne(elm);
     m_elements.remove(elm->m_id);
+    m_oldElements.remove(elm->m_id);
 }
 
 void UiScreen::setAvailableRect(const QRect &r)
@@ -25,9 +25,16 @@
 #include <QStringList>
 #include <QRect>
 #include <QJsonObject>
+#include <QJsonArray>
+#include <QPointer>
+#include <QElapsedTimer>
+#include <QAtomicInteger>
+#include <memory>
 
 class QQmlEngine;
+class QQmlIncubator;
 class QQuickItem;
+class QQuickWindow;
 class QScreen;
 
 class Element;
@@ -60,13 +67,33 @@ public:
 
 signals:
     void availableRectChanged();
+    void elementLoaded(Element *element);
     void loaded();
 
 private slots:
     void screenLoaded();
+    void incubated();
+    void reportStats();
 
 private:
-    Element *loadElement(Element *parent, QJsonObject &config, QHash<int, Element *> *elements);
+    // An element waiting to be created. The jobs are run by priority, so
+    // that the background and the panels show up before the rest.
+    struct Job {
+        QPointer<Element> parent;
+        bool topLevel;
+        QJsonObject config;
+        int priority;
+    };
+
+    void assignIds(QJsonObject &config);
+    void addJob(Element *parent, bool topLevel, const QJsonObject &config, int priority);
+    void runJobs();
+    void cancelJobs();
+    void initElement(QObject *obj);
+    void elementCreated(const Job &job, Element *elm, bool created);
+    void createWindow(Element *elm);
+    QQuickWindow *sharedWindow();
+    void trackWindow(QQuickWindow *window);
     void saveProperties(QObject *obj, const QStringList &properties, QJsonObject &config);
     void saveChildren(const QList<Element *> &children, QJsonObject &config);
     void elementDestroyed(QObject *obj);
@@ -80,6 +107,25 @@ private:
 
     QHash<int, Element *> m_elements;
     QList<Element *> m_children;
+    QHash<int, Element *> m_oldElements;
+    QList<Job> m_jobs;
+    Job m_currentJob;
+    // The elements as loaded, saved back as they are until all of them are created
+    QJsonArray m_loadedElements;
+    QQmlIncubator *m_incubator;
+    QElapsedTimer m_elementTimer;
+
+    // Updated by the render threads
+    struct RenderStats {
+        QAtomicInt frames;
+        QAtomicInteger<qint64> time;
+    };
+
+    QQuickWindow *m_sharedWindow;
+    QList<QPointer<QQuickWindow>> m_windows;
+    std::shared_ptr<RenderStats> m_renderStats;
+
+    friend class ElementIncubator;
 };
 
 #endif
@@ -0,0 +1,199 @@
+/*
+ * Copyright 2015 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This file is part of Orbital
+ *
+ * Orbital is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Orbital is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Orbital.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <time.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/timerfd.h>
+
+#include <QSocketNotifier>
+#include <QDateTime>
+#include <QDebug>
+
+#include "wakeupscheduler.h"
+
+// CLOCK_BOOTTIME keeps counting during suspend, so timers that expired while
+// suspended fire right away on resume, and the clocks get updated.
+static qint64 now()
+{
+    timespec ts;
+    clock_gettime(CLOCK_BOOTTIME, &ts);
+    return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void armClockWatch(int fd)
+{
+    // A far away realtime timer, only used to be told when the wall clock is set
+    itimerspec its = {};
+    its.it_value.tv_sec = INT32_MAX;
+    timerfd_settime(fd, TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET, &its, nullptr);
+}
+
+WakeupScheduler *WakeupScheduler::instance()
+{
+    static WakeupScheduler *scheduler = new WakeupScheduler;
+    return scheduler;
+}
+
+WakeupScheduler::WakeupScheduler()
+               : QObject()
+               , m_notifier(nullptr)
+               , m_clockNotifier(nullptr)
+               , m_nextId(1)
+               , m_armed(0)
+{
+    m_statsTimer.start();
+
+    m_fd = timerfd_create(CLOCK_BOOTTIME, TFD_CLOEXEC | TFD_NONBLOCK);
+    if (m_fd < 0) {
+        qFatal("Cannot create the wakeup timer: %s", strerror(errno));
+    }
+    m_notifier = new QSocketNotifier(m_fd, QSocketNotifier::Read, this);
+    connect(m_notifier, &QSocketNotifier::activated, this, &WakeupScheduler::expired);
+
+    m_clockFd = timerfd_create(CLOCK_REALTIME, TFD_CLOEXEC | TFD_NONBLOCK);
+    if (m_clockFd >= 0) {
+        armClockWatch(m_clockFd);
+        m_clockNotifier = new QSocketNotifier(m_clockFd, QSocketNotifier::Read, this);
+        connect(m_clockNotifier, &QSocketNotifier::activated, this, &WakeupScheduler::clockChanged);
+    }
+}
+
+WakeupScheduler::~WakeupScheduler()
+{
+    close(m_fd);
+    if (m_clockFd >= 0) {
+        close(m_clockFd);
+    }
+}
+
+int WakeupScheduler::add(const char *source, int interval, int slack, Align align, const std::function<void ()> &func)
+{
+    int id = m_nextId++;
+    Timer &timer = m_timers[id];
+    timer.source = source;
+    timer.interval = interval;
+    timer.slack = slack;
+    timer.align = align;
+    timer.func = func;
+    schedule(timer, now());
+    arm();
+    return id;
+}
+
+void WakeupScheduler::remove(int id)
+{
+    // The timerfd stays armed, we just find nothing to do if it was the only one
+    m_timers.remove(id);
+}
+
+void WakeupScheduler::schedule(Timer &timer, qint64 now)
+{
+    if (timer.align == Align::None) {
+        timer.soft = now + timer.interval;
+    } else {
+        qint64 period = timer.align == Align::Second ? 1000 : 60000;
+        qint64 wall = QDateTime::currentMSecsSinceEpoch();
+        timer.soft = now + period - wall % period;
+    }
+    timer.hard = timer.soft + timer.slack;
+}
+
+void WakeupScheduler::arm()
+{
+    // Wake up at the latest time that satisfies every timer. All the timers
+    // whose soft deadline has passed by then are run in that same wakeup.
+    qint64 deadline = 0;
+    foreach (const Timer &timer, m_timers) {
+        if (deadline == 0 || timer.hard < deadline) {
+            deadline = timer.hard;
+        }
+    }
+    if (deadline == m_armed) {
+        return;
+    }
+
+    m_armed = deadline;
+    itimerspec its = {};
+    if (deadline > 0) {
+        its.it_value.tv_sec = deadline / 1000;
+        its.it_value.tv_nsec = (deadline % 1000) * 1000000;
+    }
+    timerfd_settime(m_fd, TFD_TIMER_ABSTIME, &its, nullptr);
+}
+
+void WakeupScheduler::expired()
+{
+    uint64_t expirations;
+    if (read(m_fd, &expirations, sizeof(expirations)) < 0 && errno == EAGAIN) {
+        return;
+    }
+    m_armed = 0;
+    m_wakeups["scheduler"]++;
+
+    qint64 time = now();
+    // The callbacks may add or remove timers, so don't iterate the hash directly
+    foreach (int id, m_timers.keys()) {
+        auto it = m_timers.find(id);
+        if (it == m_timers.end() || it->soft > time) {
+            continue;
+        }
+        m_wakeups[it->source]++;
+        schedule(*it, time);
+        std::function<void ()> func = it->func;
+        func();
+    }
+    arm();
+}
+
+void WakeupScheduler::clockChanged()
+{
+    uint64_t expirations;
+    if (read(m_clockFd, &expirations, sizeof(expirations)) < 0 && errno != ECANCELED) {
+        return;
+    }
+    armClockWatch(m_clockFd);
+
+    // The wall clock was set, run the aligned timers now and align them again
+    qint64 time = now();
+    foreach (int id, m_timers.keys()) {
+        auto it = m_timers.find(id);
+        if (it == m_timers.end() || it->align == Align::None) {
+            continue;
+        }
+        schedule(*it, time);
+        std::function<void ()> func = it->func;
+        func();
+    }
+    m_armed = 0;
+    arm();
+}
+
+QVariantMap WakeupScheduler::wakeupRates()
+{
+    double secs = qMax<qint64>(1, m_statsTimer.restart()) / 1000.;
+    QVariantMap rates;
+    for (auto i = m_wakeups.constBegin(); i != m_wakeups.constEnd(); ++i) {
+        rates.insert(QString::fromLatin1(i.key()), i.value() / secs);
+    }
+    m_wakeups.clear();
+    return rates;
+}
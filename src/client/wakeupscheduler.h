@@ -0,0 +1,85 @@
+/*
+ * Copyright 2015 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This file is part of Orbital
+ *
+ * Orbital is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Orbital is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Orbital.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WAKEUPSCHEDULER_H
+#define WAKEUPSCHEDULER_H
+
+#include <functional>
+
+#include <QObject>
+#include <QHash>
+#include <QElapsedTimer>
+#include <QVariantMap>
+
+class QSocketNotifier;
+
+// Runs the periodic work of the shell from a single timerfd. Each timer has a
+// slack: it may run up to that many ms late, so that timers expiring close
+// together are run in a single wakeup.
+class WakeupScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    enum class Align {
+        None,
+        Second,
+        Minute
+    };
+
+    static WakeupScheduler *instance();
+
+    // Calls func every interval ms or, if align is not None, right after every
+    // second or minute boundary of the wall clock. Returns an id for remove().
+    int add(const char *source, int interval, int slack, Align align, const std::function<void ()> &func);
+    void remove(int id);
+
+    // Wakeups per second for each source since the last call. "scheduler" counts
+    // the expirations of the scheduler's own timer, which runs several sources at once.
+    Q_INVOKABLE QVariantMap wakeupRates();
+
+private:
+    struct Timer {
+        QByteArray source;
+        int interval;
+        int slack;
+        Align align;
+        std::function<void ()> func;
+        qint64 soft;
+        qint64 hard;
+    };
+
+    WakeupScheduler();
+    ~WakeupScheduler();
+    void schedule(Timer &timer, qint64 now);
+    void arm();
+    void expired();
+    void clockChanged();
+
+    int m_fd;
+    int m_clockFd;
+    QSocketNotifier *m_notifier;
+    QSocketNotifier *m_clockNotifier;
+    QHash<int, Timer> m_timers;
+    int m_nextId;
+    qint64 m_armed;
+    QHash<QByteArray, int> m_wakeups;
+    QElapsedTimer m_statsTimer;
+};
+
+#endif
@@ -0,0 +1,215 @@
+/*
+ * Copyright 2015 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This file is part of Orbital
+ *
+ * Orbital is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Orbital is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Orbital.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QImageReader>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+#include <QElapsedTimer>
+
+#include "wallpaperimageprovider.h"
+#include "imagecache.h"
+
+// Enough for a couple of 4K wallpapers, while the screens are picking them up
+static const int MemoryCacheSize = 72 * 1024 * 1024;
+// The decoded images are big, ~33 MB at 4K, keep only the recently used ones
+static const qint64 DiskCacheSize = 256 * 1024 * 1024;
+
+// The same values as QQuickImage::FillMode
+enum FillMode {
+    Stretch = 0,
+    PreserveAspectFit = 1,
+    PreserveAspectCrop = 2,
+    Tile = 3,
+    Pad = 6
+};
+
+class WallpaperImageResponse : public QQuickImageResponse, public QRunnable
+{
+public:
+    WallpaperImageResponse(WallpaperImageProvider *provider, const QString &id, const QSize &size)
+        : m_provider(provider)
+        , m_id(id)
+        , m_size(size)
+    {
+        setAutoDelete(false);
+    }
+
+    void run() override
+    {
+        m_image = m_provider->load(m_id, m_size);
+        emit finished();
+    }
+
+    QQuickTextureFactory *textureFactory() const override
+    {
+        return QQuickTextureFactory::textureFactoryForImage(m_image);
+    }
+
+    QString errorString() const override
+    {
+        return m_image.isNull() ? QStringLiteral("Cannot load the wallpaper %1").arg(m_id) : QString();
+    }
+
+private:
+    WallpaperImageProvider *m_provider;
+    QString m_id;
+    QSize m_size;
+    QImage m_image;
+};
+
+WallpaperImageProvider::WallpaperImageProvider()
+                      : QQuickAsyncImageProvider()
+                      , m_memoryCache(MemoryCacheSize)
+{
+    // Decoding a big image takes a lot of memory, don't do many at once
+    m_pool.setMaxThreadCount(1);
+}
+
+WallpaperImageProvider::~WallpaperImageProvider()
+{
+    m_pool.waitForDone();
+}
+
+QQuickImageResponse *WallpaperImageProvider::requestImageResponse(const QString &id, const QSize &requestedSize)
+{
+    WallpaperImageResponse *response = new WallpaperImageResponse(this, id, requestedSize);
+    m_pool.start(response);
+    return response;
+}
+
+QImage WallpaperImageProvider::load(const QString &id, const QSize &size)
+{
+    int sep = id.indexOf(QLatin1Char('/'));
+    int fillMode = id.left(sep).toInt();
+    QString path = QUrl::fromPercentEncoding(id.mid(sep + 1).toUtf8());
+    if (path.startsWith(QLatin1String("file:"))) {
+        path = QUrl(path).toLocalFile();
+    }
+    QFileInfo info(path);
+    if (sep < 1 || !info.isFile()) {
+        return QImage();
+    }
+
+    // Tiled images are shown as they are, so the size doesn't matter
+    QSize target = fillMode == Tile || !size.isValid() ? QSize() : size;
+    QString key = QStringLiteral("%1\n%2\n%3\n%4x%5").arg(path).arg(info.lastModified().toMSecsSinceEpoch())
+                                                   .arg(fillMode).arg(target.width()).arg(target.height());
+
+    // Another screen may be decoding the same thing right now, wait for it
+    QMutexLocker locker(&m_mutex);
+    while (m_loading.contains(key)) {
+        m_loaded.wait(&m_mutex);
+    }
+    if (QImage *image = m_memoryCache.object(key)) {
+        return *image;
+    }
+    m_loading.insert(key);
+    QString dir = cacheDir();
+    locker.unlock();
+
+    QString cachePath;
+    QImage image;
+    if (!dir.isEmpty()) {
+        cachePath = dir + QLatin1Char('/') + QString::fromLatin1(QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1).toHex());
+        image = ImageCache::load(cachePath);
+        if (!image.isNull()) {
+            ImageCache::touch(cachePath);
+        }
+    }
+    if (image.isNull()) {
+        QElapsedTimer timer;
+        timer.start();
+        image = decode(path, fillMode, target);
+        qDebug() << "Decoded wallpaper" << path << "at" << image.size() << "in" << timer.elapsed() << "ms";
+        if (!image.isNull() && !cachePath.isEmpty()) {
+            ImageCache::save(cachePath, image);
+            ImageCache::prune(dir, DiskCacheSize);
+        }
+    }
+
+    locker.relock();
+    if (!image.isNull()) {
+        m_memoryCache.insert(key, new QImage(image), image.byteCount());
+    }
+    m_loading.remove(key);
+    m_loaded.wakeAll();
+    return image;
+}
+
+QImage WallpaperImageProvider::decode(const QString &path, int fillMode, const QSize &target)
+{
+    QImageReader reader(path);
+    QSize source = reader.size();
+
+    QSize scaled;
+    if (target.isValid() && source.isValid()) {
+        switch (fillMode) {
+            case Stretch:
+                scaled = target;
+                break;
+            case PreserveAspectFit:
+                scaled = source.scaled(target, Qt::KeepAspectRatio);
+                break;
+            case PreserveAspectCrop:
+                scaled = source.scaled(target, Qt::KeepAspectRatioByExpanding);
+                break;
+            default:
+                break;
+        }
+    }
+
+    // Only scale down while decoding, the jpeg reader can then skip most of the work.
+    // Scaling up is left to the scene graph, there is nothing to gain doing it here.
+    if (scaled.isValid() && scaled.width() <= source.width() && scaled.height() <= source.height()) {
+        reader.setScaledSize(scaled);
+    }
+
+    QImage image = reader.read();
+    if (image.isNull()) {
+        qWarning() << "Cannot decode the wallpaper" << path << ":" << reader.errorString();
+        return image;
+    }
+
+    // Cut away what would not be visible anyway
+    if (target.isValid() && (fillMode == PreserveAspectCrop || fillMode == Pad)) {
+        QSize visible = image.size().boundedTo(target);
+        if (fillMode == PreserveAspectCrop && image.size() != scaled) {
+            // the image was scaled up, the crop area must scale with it
+            visible = image.size().boundedTo(target.scaled(image.size(), Qt::KeepAspectRatio));
+        }
+        if (visible != image.size()) {
+            image = image.copy((image.width() - visible.width()) / 2, (image.height() - visible.height()) / 2,
+                               visible.width(), visible.height());
+        }
+    }
+    return image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+}
+
+QString WallpaperImageProvider::cacheDir()
+{
+    if (m_cacheDir.isNull()) {
+        QDir root(QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + QStringLiteral("/orbital"));
+        m_cacheDir = root.mkpath(QStringLiteral("wallpapers")) ? root.filePath(QStringLiteral("wallpapers")) : QStringLiteral("");
+    }
+    return m_cacheDir;
+}
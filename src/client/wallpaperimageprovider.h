@@ -0,0 +1,57 @@
+/*
+ * Copyright 2015 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This file is part of Orbital
+ *
+ * Orbital is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Orbital is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Orbital.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WALLPAPERIMAGEPROVIDER_H
+#define WALLPAPERIMAGEPROVIDER_H
+
+#include <QQuickAsyncImageProvider>
+#include <QThreadPool>
+#include <QCache>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QSet>
+
+// Serves "image://wallpaper/<fillMode>/<path>". The image is decoded already
+// scaled to the requested size, which should be the output's pixel size, and
+// the result is shared by all the screens asking for the same thing and
+// saved on disk, so that the next time it doesn't need decoding at all.
+class WallpaperImageProvider : public QQuickAsyncImageProvider
+{
+public:
+    WallpaperImageProvider();
+    ~WallpaperImageProvider();
+
+    QQuickImageResponse *requestImageResponse(const QString &id, const QSize &requestedSize) override;
+
+private:
+    QImage load(const QString &id, const QSize &size);
+    QImage decode(const QString &path, int fillMode, const QSize &size);
+    QString cacheDir();
+
+    QThreadPool m_pool;
+    QMutex m_mutex;
+    QWaitCondition m_loaded;
+    QSet<QString> m_loading;
+    QCache<QString, QImage> m_memoryCache;
+    QString m_cacheDir;
+
+    friend class WallpaperImageResponse;
+};
+
+#endif
@@ -47,6 +47,7 @@ public:
     explicit Window(desktop_shell_window *window, pid_t pid, QObject *p = nullptr);
     ~Window();
 
+    inline desktop_shell_window *handle() const { return m_window; }
     inline quint64 pid() const { return m_pid; }
 
     inline QString title() const { return m_title; }
@@ -0,0 +1,162 @@
+/*
+ * Copyright 2015 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This file is part of Orbital
+ *
+ * Orbital is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Orbital is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Orbital.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtQml>
+
+#include "windowmodel.h"
+#include "window.h"
+#include "client.h"
+
+static const int a = qmlRegisterType<WindowFilterModel>("Orbital", 1, 0, "WindowFilterModel");
+static const int b = qmlRegisterType<WindowModel>();
+
+WindowModel::WindowModel(QObject *p)
+           : QAbstractListModel(p)
+{
+}
+
+int WindowModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_windows.count();
+}
+
+QVariant WindowModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_windows.count()) {
+        return QVariant();
+    }
+
+    Window *w = m_windows.at(index.row());
+    switch (role) {
+        case WindowRole:
+            return QVariant::fromValue(w);
+        case TitleRole:
+            return w->title();
+        case IconRole:
+            return w->icon();
+        case StateRole:
+            return (int)w->state();
+        case PidRole:
+            return w->pid();
+        default:
+            return QVariant();
+    }
+}
+
+QHash<int, QByteArray> WindowModel::roleNames() const
+{
+    QHash<int, QByteArray> roles;
+    roles.insert(WindowRole, "window");
+    roles.insert(TitleRole, "title");
+    roles.insert(IconRole, "icon");
+    roles.insert(StateRole, "state");
+    roles.insert(PidRole, "pid");
+    return roles;
+}
+
+void WindowModel::addWindow(Window *w)
+{
+    int row = m_windows.count();
+    beginInsertRows(QModelIndex(), row, row);
+    m_windows << w;
+    m_handles.insert(w->handle(), w);
+    endInsertRows();
+
+    connect(w, &Window::titleChanged, this, [this, w]() { windowChanged(w, TitleRole); });
+    connect(w, &Window::iconChanged, this, [this, w]() { windowChanged(w, IconRole); });
+    connect(w, &Window::stateChanged, this, [this, w]() { windowChanged(w, StateRole); });
+}
+
+void WindowModel::removeWindow(Window *w)
+{
+    int row = m_windows.indexOf(w);
+    if (row < 0) {
+        return;
+    }
+
+    disconnect(w, nullptr, this, nullptr);
+    beginRemoveRows(QModelIndex(), row, row);
+    m_windows.removeAt(row);
+    m_handles.remove(w->handle());
+    endRemoveRows();
+}
+
+void WindowModel::windowChanged(Window *w, int role)
+{
+    QModelIndex idx = index(m_windows.indexOf(w));
+    emit dataChanged(idx, idx, QVector<int>() << role);
+}
+
+
+
+WindowFilterModel::WindowFilterModel(QObject *p)
+                 : QSortFilterProxyModel(p)
+                 , m_minimizedOnly(false)
+                 , m_activeOnly(false)
+                 , m_pid(0)
+{
+    setDynamicSortFilter(true);
+    setSourceModel(Client::client()->windowModel());
+
+    connect(this, &QAbstractItemModel::rowsInserted, this, &WindowFilterModel::countChanged);
+    connect(this, &QAbstractItemModel::rowsRemoved, this, &WindowFilterModel::countChanged);
+    connect(this, &QAbstractItemModel::modelReset, this, &WindowFilterModel::countChanged);
+}
+
+void WindowFilterModel::setMinimizedOnly(bool m)
+{
+    if (m_minimizedOnly != m) {
+        m_minimizedOnly = m;
+        invalidateFilter();
+        emit minimizedOnlyChanged();
+    }
+}
+
+void WindowFilterModel::setActiveOnly(bool a)
+{
+    if (m_activeOnly != a) {
+        m_activeOnly = a;
+        invalidateFilter();
+        emit activeOnlyChanged();
+    }
+}
+
+void WindowFilterModel::setPid(quint64 pid)
+{
+    if (m_pid != pid) {
+        m_pid = pid;
+        invalidateFilter();
+        emit pidChanged();
+    }
+}
+
+bool WindowFilterModel::filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const
+{
+    Window *w = sourceModel()->index(sourceRow, 0, sourceParent).data(WindowModel::WindowRole).value<Window *>();
+    if (!w) {
+        return false;
+    }
+    if (m_minimizedOnly && !w->isMinimized()) {
+        return false;
+    }
+    if (m_activeOnly && !w->isActive()) {
+        return false;
+    }
+    return !m_pid || w->pid() == m_pid;
+}
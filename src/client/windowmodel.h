@@ -0,0 +1,97 @@
+/*
+ * Copyright 2015 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This file is part of Orbital
+ *
+ * Orbital is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Orbital is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Orbital.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WINDOWMODEL_H
+#define WINDOWMODEL_H
+
+#include <QAbstractListModel>
+#include <QSortFilterProxyModel>
+#include <QHash>
+
+struct desktop_shell_window;
+
+class Window;
+
+class WindowModel : public QAbstractListModel
+{
+    Q_OBJECT
+public:
+    enum Roles {
+        WindowRole = Qt::UserRole + 1,
+        TitleRole,
+        IconRole,
+        StateRole,
+        PidRole
+    };
+
+    explicit WindowModel(QObject *p = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    void addWindow(Window *w);
+    void removeWindow(Window *w);
+
+    const QList<Window *> &windows() const { return m_windows; }
+    Window *window(desktop_shell_window *handle) const { return m_handles.value(handle); }
+
+private:
+    void windowChanged(Window *w, int role);
+
+    QList<Window *> m_windows;
+    QHash<desktop_shell_window *, Window *> m_handles;
+};
+
+// Filters the client's windows. Changes of the windows are applied to the
+// filter row by row, so a window changing state doesn't reset the views.
+class WindowFilterModel : public QSortFilterProxyModel
+{
+    Q_OBJECT
+    Q_PROPERTY(bool minimizedOnly READ minimizedOnly WRITE setMinimizedOnly NOTIFY minimizedOnlyChanged)
+    Q_PROPERTY(bool activeOnly READ activeOnly WRITE setActiveOnly NOTIFY activeOnlyChanged)
+    Q_PROPERTY(quint64 pid READ pid WRITE setPid NOTIFY pidChanged)
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+public:
+    explicit WindowFilterModel(QObject *p = nullptr);
+
+    bool minimizedOnly() const { return m_minimizedOnly; }
+    void setMinimizedOnly(bool m);
+    bool activeOnly() const { return m_activeOnly; }
+    void setActiveOnly(bool a);
+    quint64 pid() const { return m_pid; }
+    void setPid(quint64 pid);
+    int count() const { return rowCount(); }
+
+signals:
+    void minimizedOnlyChanged();
+    void activeOnlyChanged();
+    void pidChanged();
+    void countChanged();
+
+protected:
+    bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const override;
+
+private:
+    bool m_minimizedOnly;
+    bool m_activeOnly;
+    quint64 m_pid;
+};
+
+#endif
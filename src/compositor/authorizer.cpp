@@ -19,10 +19,16 @@
 
 #include <functional>
 
+#include <unistd.h>
+#include <sys/stat.h>
+
 #include <QDebug>
+#include <QSocketNotifier>
+#include <QStandardPaths>
 
 #include "authorizer.h"
 #include "compositor.h"
+#include "policywatcher.h"
 #include "utils.h"
 #include "wayland-authorizer-server-protocol.h"
 #include "wayland-authorizer-helper-server-protocol.h"
@@ -99,7 +105,7 @@ public:
     ~TrustedClient() { wl_list_remove(&listener.listener.link); }
     Authorizer *authorizer;
     wl_client *client;
-    QByteArray interface;
+    QSet<QByteArray> interfaces;
     struct Listener {
         wl_listener listener;
         TrustedClient *parent;
@@ -112,56 +118,113 @@ Authorizer::Authorizer(Compositor *compositor)
           : QObject(compositor)
           , Global(compositor, &orbital_authorizer_interface, 1)
           , m_helper(new Helper(compositor, this))
+          , m_cachedDecisions(0)
+          , m_helperDecisions(0)
+          , m_policyGeneration(0)
+          , m_policyNotifier(nullptr)
 {
+    // keep these in sync with the ones orbital-authorizer-helper reads
+    QStringList files;
+    files << QStandardPaths::writableLocation(QStandardPaths::ConfigLocation) + QStringLiteral("/orbital/restricted_interfaces.conf")
+          << QStringLiteral("/etc/orbital/restricted_interfaces.conf");
+    m_policyWatcher = new PolicyWatcher(files);
+    if (m_policyWatcher->isValid()) {
+        m_policyNotifier = new QSocketNotifier(m_policyWatcher->fd(), QSocketNotifier::Read, this);
+        connect(m_policyNotifier, &QSocketNotifier::activated, [this]() { policiesChanged(); });
+    } else {
+        qWarning("Authorization decisions will not be cached.");
+        delete m_policyWatcher;
+        m_policyWatcher = nullptr;
+    }
 }
 
 Authorizer::~Authorizer()
 {
     delete m_helper;
-    for (auto i = m_trustedClients.constBegin(); i != m_trustedClients.constEnd(); ++i) {
-        qDeleteAll(i.value());
-    }
+    qDeleteAll(m_trustedClients);
+    delete m_policyNotifier;
+    delete m_policyWatcher;
 }
 
 void Authorizer::addRestrictedInterface(const QByteArray &interface)
 {
-    if (!m_restrictedIfaces.contains(interface)) {
-        m_restrictedIfaces << interface;
-    }
+    m_restrictedIfaces.insert(interface);
 }
 
 void Authorizer::removeRestrictedInterface(const QByteArray &interface)
 {
-    m_restrictedIfaces.removeOne(interface);
+    m_restrictedIfaces.remove(interface);
 }
 
 void Authorizer::addTrustedClient(const QByteArray &interface, wl_client *c)
 {
-    TrustedClient *cl = new TrustedClient;
-    cl->authorizer = this;
-    cl->client = c;
-    cl->interface = interface;
-    cl->listener.parent = cl;
-    cl->listener.listener.notify = [](wl_listener *l, void *data)
-    {
-        TrustedClient *client = reinterpret_cast<TrustedClient::Listener *>(l)->parent;
-        client->authorizer->m_trustedClients[client->interface].removeOne(client);
-        delete client;
-    };
-    wl_client_add_destroy_listener(c, &cl->listener.listener);
+    TrustedClient *cl = m_trustedClients.value(c);
+    if (!cl) {
+        cl = new TrustedClient;
+        cl->authorizer = this;
+        cl->client = c;
+        cl->listener.parent = cl;
+        cl->listener.listener.notify = [](wl_listener *l, void *data)
+        {
+            TrustedClient *client = reinterpret_cast<TrustedClient::Listener *>(l)->parent;
+            client->authorizer->m_trustedClients.remove(client->client);
+            delete client;
+        };
+        wl_client_add_destroy_listener(c, &cl->listener.listener);
+        m_trustedClients.insert(c, cl);
+    }
 
-    m_trustedClients[interface] << cl;
+    cl->interfaces.insert(interface);
 }
 
 bool Authorizer::isClientTrusted(const QByteArray &interface, wl_client *c) const
 {
-    for (TrustedClient *cl: m_trustedClients.value(interface)) {
-        if (cl->client == c) {
-            return true;
-        }
+    TrustedClient *cl = m_trustedClients.value(c);
+    return cl && cl->interfaces.contains(interface);
+}
+
+void Authorizer::policiesChanged()
+{
+    if (!m_policyWatcher->readEvents()) {
+        return;
     }
 
-    return false;
+    qDebug("Authorization policies changed, dropping %d cached decisions.", m_decisions.count());
+    m_decisions.clear();
+    ++m_policyGeneration;
+    if (!m_policyWatcher->addWatches()) {
+        qWarning("Authorization decisions will not be cached anymore.");
+        delete m_policyNotifier;
+        m_policyNotifier = nullptr;
+        delete m_policyWatcher;
+        m_policyWatcher = nullptr;
+    }
+}
+
+// The cache key identifies the actual executable file, so that replacing
+// it with a different binary at the same path needs a new decision.
+static QByteArray decisionKey(const QByteArray &interface, pid_t pid)
+{
+    char path[64], exe[256];
+    snprintf(path, sizeof(path), "/proc/%d/exe", pid);
+
+    ssize_t ret = readlink(path, exe, sizeof(exe));
+    if (ret == -1 || (size_t)ret == sizeof(exe)) {
+        return QByteArray();
+    }
+
+    struct stat st;
+    if (stat(path, &st) < 0) {
+        return QByteArray();
+    }
+
+    QByteArray key = interface;
+    key += '\0';
+    key += QByteArray(exe, ret);
+    key += '\0';
+    key += QByteArray::number((qulonglong)st.st_dev) + ':' + QByteArray::number((qulonglong)st.st_ino) + ':' +
+           QByteArray::number((qlonglong)st.st_mtim.tv_sec) + '.' + QByteArray::number((qlonglong)st.st_mtim.tv_nsec);
+    return key;
 }
 
 void Authorizer::bind(wl_client *client, uint32_t version, uint32_t id)
@@ -196,13 +259,35 @@ void Authorizer::authorize(wl_client *client, wl_resource *res, uint32_t id, con
     qDebug("Authorization for global '%s' requested by process %d.", global, pid);
 
     QByteArray iface = global; //take a copy or 'global' may become invalid when the callback runs
-    m_helper->authRequested(global, pid, [this, iface, client, resource](int32_t result) {
+    QByteArray key = m_policyWatcher ? decisionKey(iface, pid) : QByteArray();
+
+    auto it = key.isNull() ? m_decisions.constEnd() : m_decisions.constFind(key);
+    if (it != m_decisions.constEnd()) {
+        ++m_cachedDecisions;
+        qDebug("Authorization %s from cache (%d cached, %d from the helper).", *it ? "granted" : "denied",
+               m_cachedDecisions, m_helperDecisions);
+        if (*it) {
+            grant(resource);
+            addTrustedClient(iface, client);
+        } else {
+            deny(resource);
+        }
+        return;
+    }
+
+    int generation = m_policyGeneration;
+    m_helper->authRequested(global, pid, [this, iface, key, client, resource, generation](int32_t result) {
+        ++m_helperDecisions;
+        qDebug("Authorization %s by the helper (%d cached, %d from the helper).", result == 1 ? "granted" : "denied",
+               m_cachedDecisions, m_helperDecisions);
+        // The helper may have decided with the policies from before a change
+        if (!key.isNull() && generation == m_policyGeneration) {
+            m_decisions.insert(key, result == 1);
+        }
         if (result == 1) {
-            qDebug("Authorization granted.");
             grant(resource);
             addTrustedClient(iface, client);
         } else {
-            qDebug("Authorization denied.");
             deny(resource);
         }
     });
@@ -23,16 +23,21 @@
 #include <QObject>
 #include <QVector>
 #include <QHash>
+#include <QSet>
+#include <QStringList>
 
 #include "interface.h"
 
 struct wl_resource;
 
+class QSocketNotifier;
+
 namespace Orbital {
 
 class Compositor;
 class TrustedClient;
 class Helper;
+class PolicyWatcher;
 
 class Authorizer : public QObject, public Global
 {
@@ -45,6 +50,9 @@ public:
 
     bool isClientTrusted(const QByteArray &interface, wl_client *c) const;
 
+    int cachedDecisions() const { return m_cachedDecisions; }
+    int helperDecisions() const { return m_helperDecisions; }
+
 protected:
     void bind(wl_client *client, uint32_t version, uint32_t id) override;
 
@@ -54,10 +62,18 @@ private:
     void grant(wl_resource *res);
     void deny(wl_resource *res);
     void addTrustedClient(const QByteArray &interface, wl_client *c);
+    void policiesChanged();
 
-    QVector<QByteArray> m_restrictedIfaces;
-    QHash<QByteArray, QVector<TrustedClient *>> m_trustedClients;
+    QSet<QByteArray> m_restrictedIfaces;
+    QHash<wl_client *, TrustedClient *> m_trustedClients;
     Helper *m_helper;
+    QHash<QByteArray, bool> m_decisions;
+    int m_cachedDecisions;
+    int m_helperDecisions;
+    // Bumped when the policies change, to not cache the answers to older requests
+    int m_policyGeneration;
+    PolicyWatcher *m_policyWatcher;
+    QSocketNotifier *m_policyNotifier;
 };
 
 }
@@ -17,6 +17,8 @@
  * along with Orbital.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <unistd.h>
+
 #include <QDebug>
 
 #include "clipboard.h"
@@ -31,15 +33,17 @@ namespace Orbital {
 
 ClipboardManager::ClipboardManager(Shell *shell)
                 : Interface(shell)
-                , Global(shell->compositor(), &orbital_clipboard_manager_interface, 1)
+                , Global(shell->compositor(), &orbital_clipboard_manager_interface, 2)
+                , m_seat(nullptr)
+                , m_source(nullptr)
+                , m_sourceSerial(0)
+                , m_serial(0)
 {
     Compositor *c = shell->compositor();
     foreach (Seat *s, c->seats()) {
-        connect(s, &Seat::selection, this, &ClipboardManager::selection);
+        addSeat(s);
     }
-    connect(c, &Compositor::seatCreated, [this](Seat *s) {
-        connect(s, &Seat::selection, this, &ClipboardManager::selection);
-    });
+    connect(c, &Compositor::seatCreated, this, &ClipboardManager::addSeat);
 }
 
 ClipboardManager::~ClipboardManager()
@@ -49,7 +53,8 @@ ClipboardManager::~ClipboardManager()
 void ClipboardManager::bind(wl_client *client, uint32_t version, uint32_t id)
 {
     static const struct orbital_clipboard_manager_interface implementation = {
-        wrapInterface(&ClipboardManager::destroy)
+        wrapInterface(&ClipboardManager::destroy),
+        wrapInterface(&ClipboardManager::receive)
     };
 
     wl_resource *resource = wl_resource_create(client, &orbital_clipboard_manager_interface, version, id);
@@ -57,6 +62,10 @@ void ClipboardManager::bind(wl_client *client, uint32_t version, uint32_t id)
         static_cast<ClipboardManager *>(wl_resource_get_user_data(r))->m_resources.removeOne(r);
     });
     m_resources << resource;
+
+    if (version >= 2) {
+        sendOffer(resource);
+    }
 }
 
 void ClipboardManager::destroy(wl_client *client, wl_resource *res)
@@ -64,11 +73,59 @@ void ClipboardManager::destroy(wl_client *client, wl_resource *res)
     wl_resource_destroy(res);
 }
 
+void ClipboardManager::addSeat(Seat *seat)
+{
+    connect(seat, &Seat::selection, this, &ClipboardManager::selection);
+    connect(seat, &QObject::destroyed, this, [this, seat]() {
+        if (m_seat == seat) {
+            m_seat = nullptr;
+            m_source = nullptr;
+            m_mimeTypes.clear();
+        }
+    });
+}
+
+void ClipboardManager::receive(wl_client *client, wl_resource *res, uint32_t serial, const char *mimeType, int32_t fd)
+{
+    if (serial != m_serial || !m_seat || !m_mimeTypes.contains(QString::fromUtf8(mimeType)) ||
+        !m_seat->sendSelectionData(mimeType, fd)) {
+        close(fd);
+    }
+}
+
 void ClipboardManager::selection(Seat *seat)
 {
+    const void *source = seat->selectionSource();
+    uint32_t sourceSerial = seat->selectionSerial();
+    QStringList mimeTypes = seat->selectionMimeTypes();
+
+    // The selection signal also fires when a client sets again the very same
+    // source. Don't make the clients refetch data that did not change.
+    if (seat == m_seat && source == m_source && sourceSerial == m_sourceSerial && mimeTypes == m_mimeTypes) {
+        return;
+    }
+
+    m_seat = seat;
+    m_source = source;
+    m_sourceSerial = sourceSerial;
+    m_mimeTypes = mimeTypes;
+    ++m_serial;
+
     foreach (wl_resource *r, m_resources) {
-        seat->sendSelection(wl_resource_get_client(r));
+        if (wl_resource_get_version(r) >= 2) {
+            sendOffer(r);
+        } else {
+            seat->sendSelection(wl_resource_get_client(r));
+        }
+    }
+}
+
+void ClipboardManager::sendOffer(wl_resource *resource)
+{
+    foreach (const QString &mimeType, m_mimeTypes) {
+        orbital_clipboard_manager_send_offer(resource, qPrintable(mimeType));
     }
+    orbital_clipboard_manager_send_selection(resource, m_serial);
 }
 
 }
@@ -22,6 +22,8 @@
 
 #include <wayland-server.h>
 
+#include <QStringList>
+
 #include "interface.h"
 
 namespace Orbital {
@@ -38,9 +40,17 @@ public:
 private:
     void bind(wl_client *client, uint32_t version, uint32_t id) override;
     void destroy(wl_client *client, wl_resource *resource);
+    void addSeat(Seat *seat);
+    void receive(wl_client *client, wl_resource *resource, uint32_t serial, const char *mimeType, int32_t fd);
     void selection(Seat *seat);
+    void sendOffer(wl_resource *resource);
 
     QVector<wl_resource *> m_resources;
+    Seat *m_seat;
+    const void *m_source;
+    uint32_t m_sourceSerial;
+    QStringList m_mimeTypes;
+    uint32_t m_serial;
 };
 
 }
@@ -18,6 +18,7 @@
  */
 
 #include <unistd.h>
+#include <fcntl.h>
 #include <signal.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
@@ -33,6 +34,8 @@
 #include <QJsonDocument>
 #include <QStandardPaths>
 #include <QFile>
+#include <QFileInfo>
+#include <QDir>
 
 #include <compositor.h>
 
@@ -49,6 +52,8 @@
 #include "pager.h"
 #include "global.h"
 #include "authorizer.h"
+#include "zygote.h"
+#include "stalldetector.h"
 
 namespace Orbital {
 
@@ -91,6 +96,8 @@ Compositor::Compositor(Backend *backend)
           , m_shell(nullptr)
           , m_bindingsCleanupHandler(new QObjectCleanupHandler)
           , m_authorizer(nullptr)
+          , m_zygote(nullptr)
+          , m_stallDetector(nullptr)
 {
     connect(&m_fakeRepaintLoopTimer, &QTimer::timeout, this, &Compositor::fakeRepaint);
 
@@ -149,8 +156,10 @@ Compositor::Compositor(Backend *backend)
 
 Compositor::~Compositor()
 {
+    delete m_stallDetector;
     delete m_authorizer;
     delete m_shell;
+    delete m_zygote;
     qDeleteAll(m_outputs);
     qDeleteAll(m_layers);
     delete m_bindingsCleanupHandler;
@@ -342,6 +351,17 @@ bool Compositor::init(const QString &socketName)
 
     weston_compositor_set_default_pointer_grab(m_compositor, &defaultPointerGrab);
 
+    // before starting any other process, they must not end up in our current cgroup
+    setupCGroups();
+
+    if (m_config[QStringLiteral("Compositor")].toObject()[QStringLiteral("Zygote")].toBool()) {
+        m_zygote = new Zygote;
+        if (!m_zygote->start()) {
+            delete m_zygote;
+            m_zygote = nullptr;
+        }
+    }
+
     m_authorizer = new Authorizer(this);
     m_shell = new Shell(this);
     Workspace *ws = m_shell->createWorkspace();
@@ -357,6 +377,15 @@ bool Compositor::init(const QString &socketName)
         }
     });
 
+    // Log slow main loop iterations, and dump what the main thread is doing
+    // when it is stuck. The watchdog below is the last resort.
+    QJsonObject compositorConfig = m_config[QStringLiteral("Compositor")].toObject();
+    int stallThreshold = compositorConfig[QStringLiteral("StallThreshold")].toInt(50);
+    if (stallThreshold > 0) {
+        int backtraceThreshold = compositorConfig[QStringLiteral("StallBacktraceThreshold")].toInt(1000);
+        m_stallDetector = new StallDetector(m_display, stallThreshold, backtraceThreshold);
+    }
+
     alarm(WATCHDOG_TIMEOUT);
     startTimer(10000, Qt::VeryCoarseTimer);
 
@@ -469,10 +498,90 @@ View *Compositor::pickView(double x, double y, double *vx, double *vy) const
     return View::fromView(v);
 }
 
+static bool writeFile(const QString &path, const QByteArray &data)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size()) {
+        qWarning("Cannot write '%s' to %s: %s", data.constData(), qPrintable(path), qPrintable(file.errorString()));
+        return false;
+    }
+    return true;
+}
+
+void Compositor::setupCGroups()
+{
+    QJsonValue config = m_config[QStringLiteral("Compositor")].toObject()[QStringLiteral("ChildCGroups")];
+    if (!config.isObject()) {
+        return;
+    }
+
+    QFile self(QStringLiteral("/proc/self/cgroup"));
+    if (!self.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    QString path;
+    foreach (const QByteArray &line, self.readAll().split('\n')) {
+        // the unified hierarchy is the one with id 0 and no controllers
+        if (line.startsWith("0::")) {
+            path = QString::fromLocal8Bit(line.mid(3));
+        }
+    }
+    if (path.isEmpty()) {
+        qWarning("Not using cgroups for the child processes, no cgroup v2 hierarchy found.");
+        return;
+    }
+
+    QString root = QStringLiteral("/sys/fs/cgroup") + path;
+    // cgroup v2 doesn't allow processes in groups that distribute controllers
+    // to their children, so move ourselves into a leaf first.
+    QDir dir(root);
+    if ((!dir.exists(QStringLiteral("compositor")) && !dir.mkdir(QStringLiteral("compositor"))) ||
+        !writeFile(root + QStringLiteral("/compositor/cgroup.procs"), QByteArray::number(getpid()))) {
+        qWarning("Not using cgroups for the child processes, %s is not delegated to us.", qPrintable(root));
+        return;
+    }
+
+    // Enable what we can, the groups are still useful for accounting without controllers.
+    static const char *controllers[] = { "+memory", "+pids", "+cpu" };
+    for (const char *controller: controllers) {
+        writeFile(root + QStringLiteral("/cgroup.subtree_control"), controller);
+    }
+
+    m_cgroupRoot = root;
+    m_cgroupLimits = config.toObject();
+}
+
+QByteArray Compositor::childCGroup(const QString &program)
+{
+    if (m_cgroupRoot.isEmpty()) {
+        return QByteArray();
+    }
+
+    QString name = QFileInfo(program).fileName();
+    QDir dir(m_cgroupRoot);
+    if (!dir.exists(name) && !dir.mkdir(name)) {
+        qWarning("Cannot create the cgroup for %s.", qPrintable(program));
+        return QByteArray();
+    }
+
+    QString path = dir.filePath(name);
+    // e.g. "ChildCGroups": { "orbital-client": { "memory.max": "1G" } }
+    QJsonObject limits = m_cgroupLimits[name].toObject();
+    for (auto i = limits.constBegin(); i != limits.constEnd(); ++i) {
+        if (i.key().contains('/')) {
+            continue;
+        }
+        QJsonValue v = i.value();
+        writeFile(path + '/' + i.key(), v.isDouble() ? QByteArray::number(v.toDouble(), 'f', 0) : v.toString().toUtf8());
+    }
+
+    return QFile::encodeName(path);
+}
+
 ChildProcess *Compositor::launchProcess(const QString &path)
 {
     qDebug("Launching '%s'...", qPrintable(path));
-    ChildProcess *p = new ChildProcess(m_compositor->wl_display, path);
+    ChildProcess *p = new ChildProcess(this, path);
     p->start();
     return p;
 }
@@ -563,14 +672,24 @@ struct ChildProcess::Listener
     ChildProcess *parent;
 };
 
-ChildProcess::ChildProcess(wl_display *dpy, const QString &program)
+// A child that dies before running this long counts as crashing in a loop
+static const int CrashLoopUptime = 30000;
+static const int MaxCrashes = 5;
+static const int MinRestartDelay = 250;
+static const int RssSampleInterval = 10000;
+
+ChildProcess::ChildProcess(Compositor *compositor, const QString &program)
             : QObject()
-            , m_display(dpy)
+            , m_compositor(compositor)
             , m_program(program)
             , m_client(nullptr)
             , m_autoRestart(false)
             , m_listener(new Listener)
             , m_deathCount(0)
+            , m_restartCount(0)
+            , m_pid(0)
+            , m_peakRss(0)
+            , m_cgroup(compositor->childCGroup(program))
 {
     m_listener->parent = this;
     m_listener->listener.notify = [](wl_listener *l, void *data) {
@@ -578,6 +697,13 @@ ChildProcess::ChildProcess(wl_display *dpy, const QString &program)
         p->finished();
     };
     wl_list_init(&m_listener->listener.link);
+
+    m_restartTimer.setSingleShot(true);
+    connect(&m_restartTimer, &QTimer::timeout, [this]() {
+        m_restartCount++;
+        start();
+    });
+    connect(&m_rssTimer, &QTimer::timeout, this, &ChildProcess::sampleRss);
 }
 
 ChildProcess::~ChildProcess()
@@ -599,35 +725,65 @@ wl_client *ChildProcess::client() const
     return m_client;
 }
 
+qint64 ChildProcess::uptime() const
+{
+    return m_client && m_uptime.isValid() ? m_uptime.elapsed() : 0;
+}
+
 void ChildProcess::start()
 {
     int sv[2];
     socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv);
 
-    class Process : public QProcess
-    {
-    public:
-        Process(int fd) : QProcess(), socket(fd) {}
-        void setupChildProcess() override
-        {
-            int fd = dup(socket);
-            setenv("WAYLAND_SOCKET", qPrintable(QString::number(fd)), 1);
-            setpriority(PRIO_PROCESS, getpid(), 0);
+    m_pid = 0;
+    m_peakRss = 0;
+
+    // The zygote takes its own copy of the fd, so we can close ours right away
+    qint64 pid;
+    Zygote *zygote = m_compositor->m_zygote;
+    if (zygote && zygote->launch(m_program, sv[1], &pid)) {
+        close(sv[1]);
+        m_pid = pid;
+        if (!m_cgroup.isEmpty()) {
+            writeFile(QFile::decodeName(m_cgroup) + QStringLiteral("/cgroup.procs"), QByteArray::number(pid));
         }
+    } else {
+        class Process : public QProcess
+        {
+        public:
+            Process(int fd, const QByteArray &cg) : QProcess(), socket(fd), cgroup(cg.isEmpty() ? cg : cg + "/cgroup.procs") {}
+            void setupChildProcess() override
+            {
+                int fd = dup(socket);
+                setenv("WAYLAND_SOCKET", qPrintable(QString::number(fd)), 1);
+                setpriority(PRIO_PROCESS, getpid(), 0);
+
+                // move into our cgroup before exec, so that it accounts for everything
+                if (!cgroup.isEmpty()) {
+                    int cg = open(cgroup.constData(), O_WRONLY | O_CLOEXEC);
+                    if (cg >= 0) {
+                        ::write(cg, "0", 1);
+                        close(cg);
+                    }
+                }
+            }
+
+            int socket;
+            QByteArray cgroup;
+        };
+
+        Process *process = new Process(sv[1], m_cgroup);
+        connect(process, (void (QProcess::*)(QProcess::ProcessError))&QProcess::error, [this](QProcess::ProcessError err) {
+            qDebug("%s: error %d\n", qPrintable(m_program), (int)err);
+        });
+        process->setProcessChannelMode(QProcess::ForwardedChannels);
+        process->start(m_program);
+        connect(process, &QProcess::started, [sv]() { close(sv[1]); });
+        connect(process, (void (QProcess::*)(int))&QProcess::finished, process, &QObject::deleteLater);
+        m_pid = process->processId();
+    }
 
-        int socket;
-    };
-
-    Process *process = new Process(sv[1]);
-    connect(process, (void (QProcess::*)(QProcess::ProcessError))&QProcess::error, [this](QProcess::ProcessError err) {
-        qDebug("%s: error %d\n", qPrintable(m_program), (int)err);
-    });
-    process->setProcessChannelMode(QProcess::ForwardedChannels);
-    process->start(m_program);
-    connect(process, &QProcess::started, [sv]() { close(sv[1]); });
-    connect(process, (void (QProcess::*)(int))&QProcess::finished, process, &QObject::deleteLater);
-
-    m_client = wl_client_create(m_display, sv[0]);
+    m_client = wl_client_create(m_compositor->m_display, sv[0]);
     if (!m_client) {
         close(sv[0]);
         qDebug("wl_client_create failed while launching '%s'.", qPrintable(m_program));
@@ -636,50 +792,89 @@ void ChildProcess::start()
 
     wl_client_add_destroy_listener(m_client, &m_listener->listener);
 
-    if (m_deathCount == 0) {
-        struct timespec now;
-        clock_gettime(CLOCK_MONOTONIC, &now);
-        m_startTime = now.tv_sec;
+    m_uptime.start();
+    if (m_pid > 0) {
+        m_rssTimer.start(RssSampleInterval);
     }
 }
 
 void ChildProcess::restart()
 {
+    m_restartTimer.stop();
     if (m_client) {
         wl_list_remove(&m_listener->listener.link);
         wl_list_init(&m_listener->listener.link);
         wl_client_destroy(m_client);
         m_client = nullptr;
     }
+    m_restartCount++;
     start();
 }
 
+void ChildProcess::sampleRss()
+{
+    if (m_pid <= 0) {
+        return;
+    }
+
+    // VmHWM is the peak for the process, memory.peak also covers its children
+    QFile status(QStringLiteral("/proc/%1/status").arg(m_pid));
+    if (status.open(QIODevice::ReadOnly)) {
+        foreach (const QByteArray &line, status.readAll().split('\n')) {
+            if (line.startsWith("VmHWM:")) {
+                m_peakRss = qMax(m_peakRss, line.mid(6).trimmed().split(' ').first().toLongLong());
+                break;
+            }
+        }
+    }
+    if (!m_cgroup.isEmpty()) {
+        QFile peak(QFile::decodeName(m_cgroup) + QStringLiteral("/memory.peak"));
+        if (peak.open(QIODevice::ReadOnly)) {
+            m_peakRss = qMax(m_peakRss, peak.readAll().trimmed().toLongLong() / 1024);
+        }
+    }
+}
+
 void ChildProcess::finished()
 {
     m_client = nullptr;
     wl_list_remove(&m_listener->listener.link);
     wl_list_init(&m_listener->listener.link);
 
-    if (m_autoRestart) {
-        struct timespec now;
-        clock_gettime(CLOCK_MONOTONIC, &now);
+    // The process may still be around if it only closed the connection
+    sampleRss();
+    m_rssTimer.stop();
+    m_pid = 0;
+    qint64 uptime = m_uptime.elapsed();
+    m_uptime.invalidate();
 
-        if (now.tv_sec - m_startTime < 30) {
+    if (m_autoRestart) {
+        if (uptime < CrashLoopUptime) {
             m_deathCount++;
         } else {
             m_deathCount = 0;
         }
 
-        if (m_deathCount > 4) {
+        if (m_deathCount >= MaxCrashes) {
             qDebug("%s exited too often too fast. Giving up.", qPrintable(m_program));
             m_deathCount = 0;
             emit givingUp();
-        } else {
-            qDebug("%s exited. Restarting it...", qPrintable(m_program));
-            start();
+            return;
+        }
+
+        // Back off exponentially if it keeps crashing, with some jitter so that
+        // children crashing because of the same problem don't restart in lockstep.
+        // We give up after MaxCrashes, so this never goes past a few seconds.
+        int delay = 0;
+        if (m_deathCount > 0) {
+            delay = MinRestartDelay << (m_deathCount - 1);
+            delay += qrand() % (delay / 2 + 1);
         }
+        qDebug("%s exited after %lld ms, peak RSS %lld kB, %d restarts. Restarting it in %d ms...",
+               qPrintable(m_program), uptime, m_peakRss, m_restartCount, delay);
+        m_restartTimer.start(delay);
     } else {
-        qDebug("%s exited.", qPrintable(m_program));
+        qDebug("%s exited after %lld ms, peak RSS %lld kB.", qPrintable(m_program), uptime, m_peakRss);
     }
 }
 
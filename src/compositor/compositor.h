@@ -22,6 +22,7 @@
 
 #include <QObject>
 #include <QTimer>
+#include <QElapsedTimer>
 #include <QJsonObject>
 #include <QMultiHash>
 #include <QVector>
@@ -56,6 +57,8 @@ class AxisBinding;
 class HotSpotBinding;
 class Surface;
 class Authorizer;
+class Zygote;
+class StallDetector;
 struct Listener;
 enum class PointerButton : unsigned char;
 enum class PointerAxis : unsigned char;
@@ -91,6 +94,7 @@ public:
     QList<Output *> outputs() const;
     QList<Seat *> seats() const;
     const Keymap &defaultKeymap() const { return m_defaultKeymap; }
+    const QJsonObject &config() const { return m_config; }
 
     uint32_t nextSerial() const;
 
@@ -98,6 +102,7 @@ public:
     ChildProcess *launchProcess(const QString &path);
 
     Authorizer *authorizer() const { return m_authorizer; }
+    bool hasZygote() const { return m_zygote; }
 
     void kill(Surface *surface);
 
@@ -126,6 +131,8 @@ private:
     void handleSignal();
     void newOutput(weston_output *o);
     void fakeRepaint();
+    void setupCGroups();
+    QByteArray childCGroup(const QString &program);
 
     wl_display *m_display;
     wl_event_loop *m_loop;
@@ -142,11 +149,16 @@ private:
     QMultiHash<int, HotSpotBinding *> m_hotSpotBindings;
     Keymap m_defaultKeymap;
     Authorizer *m_authorizer;
+    Zygote *m_zygote;
+    StallDetector *m_stallDetector;
+    QString m_cgroupRoot;
+    QJsonObject m_cgroupLimits;
 
     friend class Global;
     friend class RestrictedGlobal;
     friend class XWayland;
     friend class Pointer;
+    friend ChildProcess;
     friend DummySurface;
 };
 
@@ -160,23 +172,37 @@ public:
     void setAutoRestart(bool enabled);
     wl_client *client() const;
 
+    // How many times the process was started again after the first time
+    int restartCount() const { return m_restartCount; }
+    // Milliseconds the current instance has been running for, 0 if it is not running
+    qint64 uptime() const;
+    // The highest resident set size seen for the current or last instance, in kB
+    qint64 peakRss() const { return m_peakRss; }
+
 signals:
     void givingUp();
 
 private:
     struct Listener;
 
-    ChildProcess(wl_display *display, const QString &program);
+    ChildProcess(Compositor *compositor, const QString &program);
     void start();
     void finished();
+    void sampleRss();
 
-    wl_display *m_display;
+    Compositor *m_compositor;
     QString m_program;
     wl_client *m_client;
     bool m_autoRestart;
     Listener *m_listener;
-    int m_startTime;
     int m_deathCount;
+    int m_restartCount;
+    qint64 m_pid;
+    qint64 m_peakRss;
+    QElapsedTimer m_uptime;
+    QTimer m_restartTimer;
+    QTimer m_rssTimer;
+    QByteArray m_cgroup;
 
     friend Compositor;
 
@@ -17,9 +17,17 @@
  * along with Orbital.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <sys/socket.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <math.h>
+
 #include <QDebug>
+#include <QJsonObject>
 
 #include <wayland-server.h>
+#include <compositor.h>
 
 #include "../shell.h"
 #include "../compositor.h"
@@ -29,91 +37,194 @@
 #include "../view.h"
 #include "../animation.h"
 #include "../surface.h"
+#include "../dummysurface.h"
 #include "desktop-shell-splash.h"
 #include "wayland-desktop-shell-server-protocol.h"
 
 namespace Orbital {
 
+// The logo drawn by the builtin splash, the same planet and moon of orbital-splash
+static const int LogoWidth = 320;
+static const int LogoHeight = 220;
+static const uint32_t LogoBufferId = 2;
 
-class Splash : public QObject, public Surface::RoleHandler
+class Splash : public QObject
 {
 public:
-    Splash(DesktopShellSplash *p, View *v)
+    Splash(DesktopShellSplash *p, Output *o)
         : parent(p)
-        , view(v)
+        , output(o)
         , fadeAnimation(new Animation)
     {
-        fadeAnimation->connect(fadeAnimation, &Animation::update, [this](double v) { view->setAlpha(v); });
-        fadeAnimation->connect(fadeAnimation, &Animation::done, [this]() { done(); });
+        fadeAnimation->connect(fadeAnimation, &Animation::update, [this](double v) {
+            foreach (View *view, views) {
+                view->setAlpha(v);
+            }
+        });
+        fadeAnimation->connect(fadeAnimation, &Animation::done, [this]() { parent->splashDone(this); });
     }
 
-    ~Splash()
+    virtual ~Splash()
     {
         delete fadeAnimation;
-        delete view;
     }
 
     void fadeOut()
     {
         fadeAnimation->setStart(1.f);
         fadeAnimation->setTarget(0.f);
-        fadeAnimation->run(view->output(), 500, Animation::Flags::SendDone);
+        fadeAnimation->run(output, 500, Animation::Flags::SendDone);
     }
 
-    void done()
+    void outputDestroyed()
     {
         parent->m_splashes.remove(this);
-        if (parent->m_splashes.isEmpty()) {
-            desktop_shell_splash_send_done(parent->m_resource);
-        }
         delete this;
     }
 
-    void outputDestroyed()
+protected:
+    DesktopShellSplash *parent;
+    Output *output;
+    QList<View *> views;
+    Animation *fadeAnimation;
+};
+
+// A splash surface created by orbital-splash
+class ClientSplash : public Splash, public Surface::RoleHandler
+{
+public:
+    ClientSplash(DesktopShellSplash *p, View *v)
+        : Splash(p, v->output())
     {
-        parent->m_splashes.remove(this);
-        delete this;
+        views << v;
+    }
+
+    ~ClientSplash()
+    {
+        qDeleteAll(views);
     }
 
     void configure(int x, int y) override
     {
-        view->output()->repaint();
+        output->repaint();
     }
 
     void move(Seat *seat) override {}
+};
 
-private:
-    DesktopShellSplash *parent;
-    View *view;
-    Animation *fadeAnimation;
+// A splash drawn by the compositor itself: a solid color covering the output
+// and the logo in the middle, sharing the buffer rendered once
+class BuiltinSplash : public Splash
+{
+public:
+    BuiltinSplash(DesktopShellSplash *p, Output *o, wl_resource *logoBuffer)
+        : Splash(p, o)
+        , background(new DummySurface(p->m_shell->compositor(), o->width(), o->height()))
+        , logo(nullptr)
+    {
+        Layer *layer = p->m_shell->compositor()->layer(Compositor::Layer::Lock);
+        View *view = new View(background);
+        view->setPos(o->x(), o->y());
+        layer->addView(view);
+        view->setOutput(o);
+        views << view;
+
+        if (logoBuffer) {
+            weston_compositor *compositor = o->output()->compositor;
+            weston_surface *surface = weston_surface_create(compositor);
+            weston_buffer *buffer = weston_buffer_from_resource(logoBuffer);
+            weston_buffer_reference(&surface->buffer_ref, buffer);
+            compositor->renderer->attach(surface, buffer);
+            weston_surface_set_size(surface, LogoWidth, LogoHeight);
+            weston_surface_damage(surface);
+            logo = new Surface(surface);
+
+            view = new View(logo);
+            view->setPos(o->x() + (o->width() - LogoWidth) / 2, o->y() + (o->height() - LogoHeight) / 2);
+            layer->addView(view);
+            view->setOutput(o);
+            views << view;
+        }
+
+        foreach (View *v, views) {
+            v->update();
+        }
+    }
+
+    ~BuiltinSplash()
+    {
+        delete logo;
+        delete background;
+    }
+
+    DummySurface *background;
+    Surface *logo;
 };
 
 DesktopShellSplash::DesktopShellSplash(Shell *shell)
                   : Interface(shell)
                   , Global(shell->compositor(), &desktop_shell_splash_interface, 1)
                   , m_shell(shell)
+                  , m_client(nullptr)
+                  , m_resource(nullptr)
+                  , m_visible(true)
+                  , m_internalClient(nullptr)
+                  , m_internalClientFd(-1)
+                  , m_logo(nullptr)
 {
-    m_client = shell->compositor()->launchProcess(QStringLiteral(LIBEXEC_PATH "/orbital-splash"));
+    m_timer.start();
+
+    // The splash process is a whole Qt Quick application competing with the shell
+    // it covers for, so by default the compositor draws a static splash itself.
+    QString mode = shell->compositor()->config()[QStringLiteral("Compositor")].toObject()[QStringLiteral("Splash")].toString();
+    if (mode == QStringLiteral("client")) {
+        m_client = shell->compositor()->launchProcess(QStringLiteral(LIBEXEC_PATH "/orbital-splash"));
+        return;
+    }
+
+    createLogo();
+    foreach (Output *o, shell->compositor()->outputs()) {
+        addOutput(o);
+    }
+    connect(shell->compositor(), &Compositor::outputCreated, this, &DesktopShellSplash::addOutput);
 }
 
 DesktopShellSplash::~DesktopShellSplash()
 {
     qDeleteAll(m_splashes);
+    if (m_internalClient) {
+        wl_client_destroy(m_internalClient);
+        close(m_internalClientFd);
+    }
 }
 
 void DesktopShellSplash::hide()
 {
+    if (m_visible) {
+        qDebug("The shell loaded %lld ms after the splash was shown.", m_timer.elapsed());
+    }
+    m_visible = false;
     foreach (Splash *s, m_splashes) {
         s->fadeOut();
     }
 }
 
+void DesktopShellSplash::splashDone(Splash *splash)
+{
+    m_splashes.remove(splash);
+    if (m_splashes.isEmpty() && m_resource) {
+        desktop_shell_splash_send_done(m_resource);
+    }
+    delete splash;
+}
+
 void DesktopShellSplash::bind(wl_client *client, uint32_t version, uint32_t id)
 {
     wl_resource *resource = wl_resource_create(client, &desktop_shell_splash_interface, version, id);
-    if (client != m_client->client()) {
+    if (!m_client || client != m_client->client()) {
         wl_resource_post_error(resource, WL_DISPLAY_ERROR_INVALID_OBJECT, "permission to bind desktop_shell_splash denied");
         wl_resource_destroy(resource);
+        return;
     }
 
     static const struct desktop_shell_splash_interface implementation = {
@@ -140,10 +251,74 @@ void DesktopShellSplash::setSplashSurface(wl_resource *outputResource, wl_resour
     view->setOutput(out);
     view->update();
 
-    Splash *splash = new Splash(this, view);
+    ClientSplash *splash = new ClientSplash(this, view);
     surf->setRoleHandler(splash);
     m_splashes.insert(splash);
     connect(out, &QObject::destroyed, splash, &Splash::outputDestroyed);
 }
 
+void DesktopShellSplash::addOutput(Output *output)
+{
+    if (!m_visible) {
+        return;
+    }
+
+    BuiltinSplash *splash = new BuiltinSplash(this, output, m_logo);
+    m_splashes.insert(splash);
+    connect(output, &QObject::destroyed, splash, &Splash::outputDestroyed);
+}
+
+void DesktopShellSplash::createLogo()
+{
+    // Surfaces can only show buffers belonging to some client, so the logo
+    // buffer is owned by an internal one which never talks to us
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) < 0) {
+        qWarning("Cannot create the splash logo: socketpair failed: %s", strerror(errno));
+        return;
+    }
+    m_internalClient = wl_client_create(m_shell->compositor()->display(), sv[0]);
+    if (!m_internalClient) {
+        close(sv[0]);
+        close(sv[1]);
+        return;
+    }
+    m_internalClientFd = sv[1];
+
+    wl_shm_buffer *buffer = wl_shm_buffer_create(m_internalClient, LogoBufferId, LogoWidth, LogoHeight, LogoWidth * 4, WL_SHM_FORMAT_ARGB8888);
+    if (!buffer) {
+        return;
+    }
+
+    struct Disc {
+        double x, y, radius;
+        uint8_t gray;
+    };
+    // The moon is fixed where it would be 30 degrees into its orbit
+    const Disc discs[] = {
+        { LogoWidth / 2., LogoHeight / 2., 25, 0xbe },
+        { LogoWidth / 2. + 150 * cos(M_PI / 6), LogoHeight / 2. - 100 * sin(M_PI / 6), 10, 0x57 },
+    };
+
+    uint32_t *data = static_cast<uint32_t *>(wl_shm_buffer_get_data(buffer));
+    for (int y = 0; y < LogoHeight; ++y) {
+        for (int x = 0; x < LogoWidth; ++x) {
+            uint32_t pixel = 0;
+            for (const Disc &d: discs) {
+                // Approximate the coverage of the pixel with its distance from the edge
+                double dist = hypot(x + 0.5 - d.x, y + 0.5 - d.y);
+                double coverage = qBound(0., d.radius + 0.5 - dist, 1.);
+                if (coverage > 0) {
+                    uint32_t a = coverage * 255;
+                    uint32_t c = d.gray * a / 255;
+                    pixel = a << 24 | c << 16 | c << 8 | c;
+                }
+            }
+            data[y * LogoWidth + x] = pixel;
+        }
+    }
+
+    m_logo = wl_client_get_object(m_internalClient, LogoBufferId);
+}
+
 }
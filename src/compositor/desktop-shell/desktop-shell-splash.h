@@ -21,16 +21,21 @@
 #define ORBITAL_DESKTOP_SHELL_SPLASH
 
 #include <QSet>
+#include <QElapsedTimer>
 
 #include "../interface.h"
 
 struct wl_resource;
+struct wl_client;
 
 namespace Orbital {
 
 class Shell;
 class ChildProcess;
+class Output;
 class Splash;
+class ClientSplash;
+class BuiltinSplash;
 
 class DesktopShellSplash : public Interface, public Global
 {
@@ -46,13 +51,23 @@ protected:
 
 private:
     void setSplashSurface(wl_resource *outputResource, wl_resource *surfaceResource);
+    void addOutput(Output *output);
+    void createLogo();
+    void splashDone(Splash *splash);
 
     Shell *m_shell;
     ChildProcess *m_client;
     wl_resource *m_resource;
     QSet<Splash *> m_splashes;
+    bool m_visible;
+    QElapsedTimer m_timer;
+    wl_client *m_internalClient;
+    int m_internalClientFd;
+    wl_resource *m_logo;
 
     friend Splash;
+    friend ClientSplash;
+    friend BuiltinSplash;
 };
 
 }
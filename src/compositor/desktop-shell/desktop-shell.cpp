@@ -64,7 +64,12 @@ DesktopShell::DesktopShell(Shell *shell)
     m_shell->addInterface(new DesktopShellSettings(shell));
     m_shell->addInterface(m_splash);
 
-    m_client = shell->compositor()->launchProcess(QStringLiteral(LIBEXEC_PATH "/startorbital"));
+    // startorbital only execs orbital-client, skip it when the zygote can fork the client directly
+    if (shell->compositor()->hasZygote()) {
+        m_client = shell->compositor()->launchProcess(QStringLiteral(LIBEXEC_PATH "/orbital-client"));
+    } else {
+        m_client = shell->compositor()->launchProcess(QStringLiteral(LIBEXEC_PATH "/startorbital"));
+    }
     m_client->setAutoRestart(true);
     connect(m_client, &ChildProcess::givingUp, this, &DesktopShell::givingUp);
 
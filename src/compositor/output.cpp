@@ -39,9 +39,16 @@ struct Listener {
     Output *output;
 };
 
-static void outputDestroyed(wl_listener *listener, void *data)
-{
-    delete reinterpret_cast<Listener *>(listener)->output;
+void outputDestroyed(wl_listener *listener, void *data)
+{
+    Output *output = reinterpret_cast<Listener *>(listener)->output;
+    // The output was unplugged, don't leave a lock waiting forever for a
+    // frame that will never come. This is not done in ~Output(), at shutdown
+    // the shell the callbacks point to is already gone.
+    while (!output->m_callbacks.isEmpty()) {
+        output->m_callbacks.takeFirst()();
+    }
+    delete output;
 }
 
 class Root : public DummySurface
@@ -260,8 +267,21 @@ Surface *Output::lockSurface() const
 
 void Output::lock(const std::function<void ()> &done)
 {
+    // The lock surface is always in the lock layer, so locking is just a matter
+    // of unmasking it and waiting for the next frame
     m_locked = true;
     m_lockLayer->setMask(x(), y(), width(), height());
+
+    // When the outputs are off weston doesn't repaint them, and the frame would
+    // only come after waking up. There is nothing shown to hide anyway, and the
+    // first frame after waking up will have the lock surface.
+    weston_compositor *c = m_output->compositor;
+    if (c->state == WESTON_COMPOSITOR_SLEEPING || c->state == WESTON_COMPOSITOR_OFFSCREEN) {
+        if (done) {
+            done();
+        }
+        return;
+    }
     repaint(done);
 }
 
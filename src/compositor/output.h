@@ -26,6 +26,7 @@
 #include <QRect>
 
 struct wl_resource;
+struct wl_listener;
 struct weston_output;
 
 namespace Orbital {
@@ -110,6 +111,7 @@ private:
     friend View;
     friend Animation;
     friend Pager;
+    friend void outputDestroyed(wl_listener *listener, void *data);
 };
 
 }
@@ -0,0 +1,85 @@
+/*
+ * Copyright 2015 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This file is part of Orbital
+ *
+ * Orbital is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Orbital is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Orbital.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/inotify.h>
+
+#include <QFileInfo>
+
+#include "policywatcher.h"
+
+namespace Orbital {
+
+PolicyWatcher::PolicyWatcher(const QStringList &files)
+             : m_files(files)
+             , m_fd(inotify_init1(IN_CLOEXEC | IN_NONBLOCK))
+{
+    if (m_fd < 0) {
+        qWarning("Cannot watch the authorization policies: %s", strerror(errno));
+    } else if (!addWatches()) {
+        close(m_fd);
+        m_fd = -1;
+    }
+}
+
+PolicyWatcher::~PolicyWatcher()
+{
+    if (m_fd >= 0) {
+        close(m_fd);
+    }
+}
+
+bool PolicyWatcher::addWatches()
+{
+    static const uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE | IN_ATTRIB;
+
+    // Watch the directories and not the files, editors usually replace the
+    // file instead of writing into it. If the directory does not exist yet
+    // watch its parent, to know when it gets created.
+    for (const QString &file: m_files) {
+        QFileInfo info(file);
+        if (inotify_add_watch(m_fd, qPrintable(info.absolutePath()), mask) < 0 &&
+            (errno != ENOENT || inotify_add_watch(m_fd, qPrintable(QFileInfo(info.absolutePath()).absolutePath()), mask) < 0)) {
+            qWarning("Cannot watch %s: %s", qPrintable(file), strerror(errno));
+            return false;
+        }
+    }
+    return true;
+}
+
+bool PolicyWatcher::readEvents()
+{
+    char buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    bool changed = false;
+    ssize_t len;
+    while ((len = read(m_fd, buf, sizeof(buf))) > 0) {
+        for (char *ptr = buf; ptr < buf + len; ) {
+            const inotify_event *event = reinterpret_cast<const inotify_event *>(ptr);
+            if (event->len > 0 && (strcmp(event->name, "restricted_interfaces.conf") == 0 || strcmp(event->name, "orbital") == 0)) {
+                changed = true;
+            }
+            ptr += sizeof(inotify_event) + event->len;
+        }
+    }
+    return changed;
+}
+
+}
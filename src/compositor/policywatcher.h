@@ -0,0 +1,51 @@
+/*
+ * Copyright 2015 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This file is part of Orbital
+ *
+ * Orbital is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Orbital is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Orbital.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ORBITAL_POLICYWATCHER_H
+#define ORBITAL_POLICYWATCHER_H
+
+#include <QStringList>
+
+namespace Orbital {
+
+// Watches the restricted_interfaces.conf files with inotify. This is used
+// both by the compositor and by orbital-authorizer-helper, so it must not
+// depend on anything but QtCore.
+class PolicyWatcher
+{
+public:
+    explicit PolicyWatcher(const QStringList &files);
+    ~PolicyWatcher();
+
+    int fd() const { return m_fd; }
+    bool isValid() const { return m_fd >= 0; }
+
+    // Adds the watches again, needed after a directory was created or replaced.
+    bool addWatches();
+    // Drains the pending events and returns whether any of them touched the policies.
+    bool readEvents();
+
+private:
+    QStringList m_files;
+    int m_fd;
+};
+
+}
+
+#endif
@@ -17,6 +17,7 @@
  * along with Orbital.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <typeinfo>
 #include <linux/input.h>
 
 #include <QDebug>
@@ -33,6 +34,7 @@
 #include "output.h"
 #include "focusscope.h"
 #include "layer.h"
+#include "stalldetector.h"
 
 namespace Orbital {
 
@@ -156,6 +158,40 @@ void Seat::sendSelection(wl_client *client)
     weston_seat_send_selection(m_seat, client);
 }
 
+const void *Seat::selectionSource() const
+{
+    return m_seat->selection_data_source;
+}
+
+uint32_t Seat::selectionSerial() const
+{
+    return m_seat->selection_serial;
+}
+
+QStringList Seat::selectionMimeTypes() const
+{
+    QStringList mimeTypes;
+    weston_data_source *source = m_seat->selection_data_source;
+    if (source) {
+        char **p;
+        wl_array_for_each(p, &source->mime_types) {
+            mimeTypes << QString::fromUtf8(*p);
+        }
+    }
+    return mimeTypes;
+}
+
+bool Seat::sendSelectionData(const char *mimeType, int fd)
+{
+    weston_data_source *source = m_seat->selection_data_source;
+    if (!source) {
+        return false;
+    }
+    // the source takes ownership of the fd
+    source->send(source, mimeType, fd);
+    return true;
+}
+
 void Seat::setKeymap(const Keymap &keymap)
 {
     Keymap km = keymap;
@@ -667,6 +703,7 @@ void PointerGrab::start(Seat *seat)
 
     m_seat = seat;
     weston_pointer_start_grab(m_seat->pointer()->m_pointer, &m_grab->base);
+    StallDetector::setActiveGrab(typeid(*this).name());
 }
 
 void PointerGrab::start(Seat *seat, PointerCursor cursor)
@@ -681,6 +718,7 @@ void PointerGrab::end()
         weston_pointer_end_grab(m_seat->pointer()->m_pointer);
         m_seat->compositor()->shell()->unsetGrabCursor(pointer());
         m_seat = nullptr;
+        StallDetector::setActiveGrab(nullptr);
         ended();
     }
 }
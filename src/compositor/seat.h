@@ -26,6 +26,7 @@
 #include <QPointF>
 #include <QLinkedList>
 #include <QSet>
+#include <QStringList>
 
 struct wl_resource;
 struct wl_client;
@@ -65,6 +66,10 @@ public:
     void activate(FocusScope *scope);
 
     void sendSelection(wl_client *client);
+    const void *selectionSource() const;
+    uint32_t selectionSerial() const;
+    QStringList selectionMimeTypes() const;
+    bool sendSelectionData(const char *mimeType, int fd);
 
     void setKeymap(const Keymap &keymap);
 
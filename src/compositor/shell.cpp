@@ -384,6 +384,7 @@ void Shell::lock(const LockCallback &callback)
     }
 
     emit aboutToLock();
+    m_lockTimer.start();
     if (m_compositor->outputs().isEmpty()) {
         m_locked = true;
         emit locked();
@@ -393,6 +394,7 @@ void Shell::lock(const LockCallback &callback)
         foreach (Output *o, m_compositor->outputs()) {
             o->lock([this, numOuts, callback]() {
                 if (--*numOuts == 0) {
+                    qDebug("Locked %d outputs in %lld ms", m_compositor->outputs().count(), m_lockTimer.elapsed());
                     m_locked = true;
                     emit locked();
                     if (callback) {
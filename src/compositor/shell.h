@@ -23,6 +23,7 @@
 #include <functional>
 
 #include <QHash>
+#include <QElapsedTimer>
 
 #include "interface.h"
 
@@ -111,6 +112,7 @@ private:
     Pager *m_pager;
     bool m_locked;
     FocusScope *m_lockScope;
+    QElapsedTimer m_lockTimer;
     FocusScope *m_appsScope;
 };
 
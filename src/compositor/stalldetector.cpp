@@ -0,0 +1,222 @@
+/*
+ * Copyright 2015 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This file is part of Orbital
+ *
+ * Orbital is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Orbital is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Orbital.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <execinfo.h>
+#include <cxxabi.h>
+#include <atomic>
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QCoreApplication>
+#include <QAbstractEventDispatcher>
+#include <QDebug>
+
+#include <wayland-server.h>
+#include <wayland-version.h>
+
+// The protocol logger, used to know the last request, is in libwayland 1.14 and later
+#define HAVE_PROTOCOL_LOGGER (WAYLAND_VERSION_MAJOR > 1 || WAYLAND_VERSION_MINOR >= 14)
+
+#include "stalldetector.h"
+
+namespace Orbital {
+
+// Written by the main thread and read by the monitor thread, and by the
+// signal handler. They only ever point to static strings.
+static std::atomic<qint64> s_busySince(0);
+static std::atomic<quint64> s_iteration(0);
+static std::atomic<const char *> s_activeGrab(nullptr);
+static std::atomic<const char *> s_lastInterface(nullptr);
+static std::atomic<const char *> s_lastRequest(nullptr);
+static std::atomic<uint32_t> s_lastObject(0);
+static std::atomic<int> s_lastClientPid(0);
+
+static qint64 now()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static QByteArray lastRequest()
+{
+    const char *iface = s_lastInterface;
+    if (!iface) {
+        return "none";
+    }
+    return QByteArray(iface) + '@' + QByteArray::number(s_lastObject) + '.' + s_lastRequest +
+           " from pid " + QByteArray::number(s_lastClientPid);
+}
+
+static QByteArray activeGrab()
+{
+    const char *grab = s_activeGrab;
+    if (!grab) {
+        return "none";
+    }
+    int status;
+    char *demangled = abi::__cxa_demangle(grab, nullptr, nullptr, &status);
+    QByteArray name(status == 0 ? demangled : grab);
+    free(demangled);
+    return name;
+}
+
+static void dumpBacktrace(int)
+{
+    // backtrace() is not strictly signal safe, but it is the best we can do
+    // and we don't return to a sane state anyway if we are stuck.
+    void *frames[64];
+    int count = backtrace(frames, 64);
+    static const char header[] = "Main thread backtrace:\n";
+    ::write(STDERR_FILENO, header, sizeof(header) - 1);
+    backtrace_symbols_fd(frames, count, STDERR_FILENO);
+}
+
+class StallThread : public QThread
+{
+public:
+    StallThread(int threshold)
+        : QThread()
+        , m_mainThread(pthread_self())
+        , m_threshold(threshold)
+        , m_quit(false)
+    {
+    }
+
+    void stop()
+    {
+        m_mutex.lock();
+        m_quit = true;
+        m_condition.wakeOne();
+        m_mutex.unlock();
+        wait();
+    }
+
+protected:
+    void run() override
+    {
+        quint64 reported = 0;
+        QMutexLocker locker(&m_mutex);
+        while (!m_quit) {
+            m_condition.wait(&m_mutex, m_threshold / 2);
+
+            qint64 since = s_busySince;
+            quint64 iteration = s_iteration;
+            if (since == 0 || iteration == reported || now() - since < m_threshold) {
+                continue;
+            }
+
+            reported = iteration;
+            qWarning("The main loop is stuck since %lld ms. Active grab: %s. Last request: %s.",
+                     now() - since, activeGrab().constData(), lastRequest().constData());
+            pthread_kill(m_mainThread, SIGUSR2);
+        }
+    }
+
+private:
+    pthread_t m_mainThread;
+    int m_threshold;
+    bool m_quit;
+    QMutex m_mutex;
+    QWaitCondition m_condition;
+};
+
+StallDetector::StallDetector(wl_display *display, int threshold, int backtraceThreshold)
+             : QObject()
+             , m_thread(new StallThread(backtraceThreshold))
+             , m_threshold(threshold)
+{
+#if HAVE_PROTOCOL_LOGGER
+    m_logger = wl_display_add_protocol_logger(display, [](void *, wl_protocol_logger_type type, const wl_protocol_logger_message *msg) {
+        if (type != WL_PROTOCOL_LOGGER_REQUEST) {
+            return;
+        }
+        pid_t pid;
+        wl_client_get_credentials(wl_resource_get_client(msg->resource), &pid, nullptr, nullptr);
+        s_lastInterface = wl_resource_get_class(msg->resource);
+        s_lastRequest = msg->message->name;
+        s_lastObject = wl_resource_get_id(msg->resource);
+        s_lastClientPid = pid;
+    }, nullptr);
+#else
+    m_logger = nullptr;
+#endif
+
+    // Make sure libgcc is loaded now and not inside the signal handler
+    void *frame;
+    backtrace(&frame, 1);
+
+    struct sigaction sa;
+    sa.sa_handler = dumpBacktrace;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESTART;
+    sigaction(SIGUSR2, &sa, nullptr);
+
+    QAbstractEventDispatcher *dispatcher = QCoreApplication::eventDispatcher();
+    connect(dispatcher, &QAbstractEventDispatcher::awake, this, &StallDetector::awake);
+    connect(dispatcher, &QAbstractEventDispatcher::aboutToBlock, this, &StallDetector::aboutToBlock);
+
+    m_thread->start();
+}
+
+StallDetector::~StallDetector()
+{
+    m_thread->stop();
+    delete m_thread;
+#if HAVE_PROTOCOL_LOGGER
+    wl_protocol_logger_destroy(m_logger);
+#endif
+    signal(SIGUSR2, SIG_DFL);
+}
+
+void StallDetector::setActiveGrab(const char *name)
+{
+    s_activeGrab = name;
+}
+
+void StallDetector::awake()
+{
+    // awake() may be emitted more than once per iteration, keep the first one
+    if (s_busySince == 0) {
+        s_iteration++;
+        s_busySince = now();
+    }
+}
+
+void StallDetector::aboutToBlock()
+{
+    qint64 since = s_busySince;
+    s_busySince = 0;
+    if (since == 0) {
+        return;
+    }
+
+    qint64 elapsed = now() - since;
+    if (elapsed > m_threshold) {
+        qWarning("Main loop iteration took %lld ms. Active grab: %s. Last request: %s.",
+                 elapsed, activeGrab().constData(), lastRequest().constData());
+    }
+}
+
+}
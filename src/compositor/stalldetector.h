@@ -0,0 +1,53 @@
+/*
+ * Copyright 2015 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This file is part of Orbital
+ *
+ * Orbital is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Orbital is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Orbital.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ORBITAL_STALLDETECTOR_H
+#define ORBITAL_STALLDETECTOR_H
+
+#include <QObject>
+
+struct wl_display;
+struct wl_protocol_logger;
+
+namespace Orbital {
+
+class StallThread;
+
+class StallDetector : public QObject
+{
+public:
+    // Iterations longer than threshold are logged, the ones longer than
+    // backtraceThreshold also get a backtrace of the main thread.
+    StallDetector(wl_display *display, int threshold, int backtraceThreshold);
+    ~StallDetector();
+
+    static void setActiveGrab(const char *name);
+
+private:
+    void awake();
+    void aboutToBlock();
+
+    wl_protocol_logger *m_logger;
+    StallThread *m_thread;
+    int m_threshold;
+};
+
+}
+
+#endif
@@ -0,0 +1,151 @@
+/*
+ * Copyright 2015 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This file is part of Orbital
+ *
+ * Orbital is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Orbital is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Orbital.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <poll.h>
+#include <sys/socket.h>
+
+#include <QProcess>
+#include <QProcessEnvironment>
+#include <QDebug>
+
+#include "zygote.h"
+
+namespace Orbital {
+
+Zygote::Zygote()
+      : m_process(nullptr)
+      , m_socket(-1)
+{
+}
+
+Zygote::~Zygote()
+{
+    if (m_socket >= 0) {
+        close(m_socket);
+    }
+    delete m_process;
+}
+
+bool Zygote::start()
+{
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv) < 0) {
+        qWarning("Cannot create the zygote socket: %s", strerror(errno));
+        return false;
+    }
+
+    class Process : public QProcess
+    {
+    public:
+        Process(int fd) : QProcess(), socket(fd) {}
+        void setupChildProcess() override
+        {
+            int fd = dup(socket);
+            setenv("ORBITAL_ZYGOTE_SOCKET", qPrintable(QString::number(fd)), 1);
+        }
+
+        int socket;
+    };
+
+    Process *process = new Process(sv[1]);
+    process->setProcessChannelMode(QProcess::ForwardedChannels);
+    process->start(QStringLiteral(LIBEXEC_PATH "/orbital-zygote"));
+    close(sv[1]);
+    if (!process->waitForStarted()) {
+        qWarning("Cannot start the zygote: %s", qPrintable(process->errorString()));
+        close(sv[0]);
+        delete process;
+        return false;
+    }
+
+    m_process = process;
+    m_socket = sv[0];
+    return true;
+}
+
+bool Zygote::isRunning() const
+{
+    return m_process && m_process->state() == QProcess::Running;
+}
+
+bool Zygote::launch(const QString &program, int waylandSocket, qint64 *pid)
+{
+    if (!isRunning()) {
+        return false;
+    }
+
+    // Send the current environment along, it may have changed since the
+    // zygote was started.
+    QStringList env = QProcessEnvironment::systemEnvironment().toStringList();
+
+    QByteArray data;
+    data += program.toLocal8Bit() + '\0';
+    data += "1";
+    data += '\0';
+    data += program.toLocal8Bit() + '\0';
+    foreach (const QString &e, env) {
+        data += e.toLocal8Bit() + '\0';
+    }
+
+    char control[CMSG_SPACE(sizeof(int))];
+    memset(control, 0, sizeof(control));
+    iovec iov = { data.data(), (size_t)data.size() };
+    msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &waylandSocket, sizeof(int));
+
+    ssize_t ret;
+    do {
+        ret = sendmsg(m_socket, &msg, MSG_NOSIGNAL);
+    } while (ret < 0 && errno == EINTR);
+
+    if (ret < 0) {
+        qWarning("Failed to send a request to the zygote: %s", strerror(errno));
+        return false;
+    }
+
+    // The zygote answers right after fork(), don't wait forever if it got stuck.
+    pollfd pfd = { m_socket, POLLIN, 0 };
+    pid_t child = -1;
+    do {
+        ret = poll(&pfd, 1, 1000);
+    } while (ret < 0 && errno == EINTR);
+    if (ret <= 0 || recv(m_socket, &child, sizeof(child), 0) != sizeof(child)) {
+        qWarning("The zygote did not answer, stopping it.");
+        m_process->kill();
+        return false;
+    }
+
+    *pid = child;
+    return child > 0;
+}
+
+}
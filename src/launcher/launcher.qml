@@ -57,7 +57,7 @@ Rectangle {
             event.accepted = true;
         }
         Keys.onUpPressed: {
-            if (view.currentIndex < view.count - 2) {
+            if (view.currentIndex < view.count - 1) {
                 view.currentIndex++;
             }
             event.accepted = true;
@@ -71,7 +71,7 @@ Rectangle {
                 view.currentIndex = 0;
                 event.accepted = true;
             } else if (event.key == Qt.Key_End) {
-                view.currentIndex = view.count - 2;
+                view.currentIndex = view.count - 1;
                 event.accepted = true;
             } else if (event.key == Qt.Key_U && event.modifiers == Qt.ControlModifier) {
                 text.text = "";
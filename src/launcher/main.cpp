@@ -162,11 +162,7 @@ private slots:
         } else {
             args.removeFirst();
             if (QProcess::startDetached(exec, args)) {
-                QString fullCommand = exec;
-                foreach (const QString &arg, args) {
-                    fullCommand += QStringLiteral(" %1").arg(arg);
-                }
-                m_matcher->addInHistory(fullCommand);
+                m_matcher->addInHistory(exec);
             }
         }
     }
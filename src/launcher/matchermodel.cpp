@@ -20,43 +20,182 @@
 #include <stdlib.h>
 #include <dirent.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <algorithm>
 
 #include <QDebug>
 #include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QTextStream>
+#include <QDateTime>
+#include <QStandardPaths>
 #include <QFileSystemWatcher>
+#include <QElapsedTimer>
+#include <QSet>
 
 #include "matchermodel.h"
 
+// Only this many matches are ranked and shown, the rest are kept as
+// candidates for narrowing down the next, longer, expression
+static const int MaxMatches = 100;
+
+class DirectoryScan : public QRunnable
+{
+public:
+    DirectoryScan(MatcherModel *model, const QString &path)
+        : m_model(model)
+        , m_path(path)
+    {
+    }
+
+    void run() override
+    {
+        QStringList items;
+        if (DIR *dir = opendir(qPrintable(QFile::encodeName(m_path)))) {
+            int fd = dirfd(dir);
+            while (dirent *entry = readdir(dir)) {
+                if (entry->d_name[0] == '.') {
+                    continue;
+                }
+                struct stat st;
+                if (fstatat(fd, entry->d_name, &st, 0) == 0 && S_ISREG(st.st_mode) &&
+                    faccessat(fd, entry->d_name, X_OK, 0) == 0) {
+                    items << QFile::decodeName(entry->d_name);
+                }
+            }
+            closedir(dir);
+        }
+        items.sort();
+
+        QMetaObject::invokeMethod(m_model, "directoryScanned", Qt::QueuedConnection, Q_ARG(QString, m_path), Q_ARG(QStringList, items));
+    }
+
+private:
+    MatcherModel *m_model;
+    QString m_path;
+};
+
+static bool isSeparator(QChar c)
+{
+    return c == QLatin1Char('-') || c == QLatin1Char('_') || c == QLatin1Char('.') || c == QLatin1Char(' ');
+}
+
+// Matches the characters of the query in order, not necessarily contiguously.
+// Runs of consecutive characters, word starts and prefixes score higher.
+static bool fuzzyMatch(const QString &key, const QString &query, int *score)
+{
+    const int kl = key.size();
+    const int ql = query.size();
+    *score = 0;
+    if (ql == 0) {
+        return true;
+    }
+    if (ql > kl) {
+        return false;
+    }
+
+    const QChar *k = key.constData();
+    const QChar *q = query.constData();
+    int qi = 0;
+    int first = -1;
+    int prev = -2;
+    for (int i = 0; i < kl && qi < ql; ++i) {
+        if (k[i] != q[qi]) {
+            continue;
+        }
+        if (first < 0) {
+            first = i;
+        }
+        *score += 1;
+        if (prev == i - 1) {
+            *score += 5;
+        }
+        if (i == 0 || isSeparator(k[i - 1])) {
+            *score += 8;
+        }
+        prev = i;
+        ++qi;
+    }
+    if (qi < ql) {
+        return false;
+    }
+
+    if (first == 0 && prev == ql - 1) {
+        *score += kl == ql ? 100 : 50;
+    }
+    *score -= qMin(first, 10) + (kl - ql) / 4;
+    return true;
+}
+
 MatcherModel::MatcherModel()
             : QAbstractListModel()
+            , m_candidatesValid(false)
             , m_watcher(new QFileSystemWatcher(this))
 {
+    m_pool.setMaxThreadCount(1);
+    loadHistory();
+
     QString path = qgetenv("PATH");
     foreach (const QString &p, path.split(':')) {
         m_watcher->addPath(p);
     }
 
+    // The history makes the launcher usable right away, the executables
+    // appear as their directories are scanned
+    buildItemsList();
+    foreach (const QString &p, m_watcher->directories()) {
+        scanDirectory(p);
+    }
+    connect(m_watcher, &QFileSystemWatcher::directoryChanged, this, &MatcherModel::scanDirectory);
+}
+
+MatcherModel::~MatcherModel()
+{
+    m_pool.waitForDone();
+}
+
+void MatcherModel::scanDirectory(const QString &path)
+{
+    m_pool.start(new DirectoryScan(this, path));
+}
+
+void MatcherModel::directoryScanned(const QString &path, const QStringList &items)
+{
+    QStringList &old = m_directories[path];
+    if (old == items) {
+        return;
+    }
+
+    old = items;
     buildItemsList();
-    connect(m_watcher, &QFileSystemWatcher::directoryChanged, this, &MatcherModel::buildItemsList);
 }
 
 void MatcherModel::buildItemsList()
 {
-    m_items.clear();
-    foreach (const QString &p, m_watcher->directories()) {
-        QDir dir(p);
-        foreach (const QFileInfo &f, dir.entryInfoList(QDir::Files)) {
-            if (!f.isExecutable()) {
-                continue;
-            }
+    QElapsedTimer timer;
+    timer.start();
 
-            m_items << f.fileName();
-        }
+    QStringList names = m_history.keys();
+    foreach (const QStringList &items, m_directories) {
+        names += items;
     }
-    m_items.sort();
-    m_items.removeDuplicates();
+    names.sort();
+    names.removeDuplicates();
 
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    m_items.clear();
+    m_items.reserve(names.count());
+    foreach (const QString &name, names) {
+        m_items << Item{ name, name.toLower(), frecency(name, now) };
+    }
+
+    // The indices of the candidates are not valid anymore
+    m_candidatesValid = false;
     matchExpression();
+
+    qDebug("Indexed %d commands in %lld ms.", m_items.count(), timer.elapsed());
 }
 
 QString MatcherModel::expression() const
@@ -87,25 +226,22 @@ void MatcherModel::addCommand(const QString &command)
 
 int MatcherModel::rowCount(const QModelIndex &parent) const
 {
-    return m_matches.count();
+    return parent.isValid() ? 0 : m_matches.count();
 }
 
 QVariant MatcherModel::data(const QModelIndex &index, int role) const
 {
+    if (!index.isValid() || index.row() >= m_matches.count()) {
+        return QVariant();
+    }
     return m_matches.at(index.row());
 }
 
 void MatcherModel::matchExpression()
 {
-    beginResetModel();
-    m_matches.clear();
-    endResetModel();
-
     QStringList matches;
 
-    if (m_expression == m_commandPrefix) {
-        matches = m_commands;
-    } else if (m_expression.startsWith(m_commandPrefix)) {
+    if (!m_commandPrefix.isEmpty() && m_expression.startsWith(m_commandPrefix)) {
         QString command = m_expression.mid(m_commandPrefix.length());
         foreach (const QString &entry, m_commands) {
             if (entry == command) {
@@ -114,24 +250,172 @@ void MatcherModel::matchExpression()
                 matches.append(entry);
             }
         }
-    } else {
-        foreach (const QString &entry, m_items) {
-            if (entry == m_expression) {
-                matches.prepend(entry);
-            } else if (entry.startsWith(m_expression)) {
-                matches.append(entry);
+        setMatches(matches);
+        return;
+    }
+
+    struct Match {
+        int index;
+        int score;
+    };
+
+    QString query = m_expression.toLower();
+    // Anything matching a longer expression also matches its prefix, so only
+    // the candidates of the previous expression need to be looked at
+    bool narrow = m_candidatesValid && query.startsWith(m_candidatesQuery);
+    int count = narrow ? m_candidates.count() : m_items.count();
+
+    QVector<Match> found;
+    found.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        int index = narrow ? m_candidates.at(i) : i;
+        const Item &item = m_items.at(index);
+        int score;
+        if (fuzzyMatch(item.key, query, &score)) {
+            found << Match{ index, score + qMin(item.frecency / 10, 80) };
+        }
+    }
+
+    m_candidates.resize(found.count());
+    for (int i = 0; i < found.count(); ++i) {
+        m_candidates[i] = found.at(i).index;
+    }
+    m_candidatesQuery = query;
+    m_candidatesValid = true;
+
+    auto end = found.begin() + qMin(found.count(), MaxMatches);
+    std::partial_sort(found.begin(), end, found.end(), [](const Match &a, const Match &b) {
+        // The items are sorted by name, so the index breaks ties alphabetically
+        return a.score > b.score || (a.score == b.score && a.index < b.index);
+    });
+    for (auto it = found.begin(); it != end; ++it) {
+        matches << m_items.at(it->index).name;
+    }
+    setMatches(matches);
+}
+
+void MatcherModel::setMatches(const QStringList &matches)
+{
+    // Remove the rows going away, in contiguous ranges
+    QSet<QString> next = matches.toSet();
+    for (int i = m_matches.count() - 1; i >= 0; --i) {
+        if (next.contains(m_matches.at(i))) {
+            continue;
+        }
+        int last = i;
+        while (i > 0 && !next.contains(m_matches.at(i - 1))) {
+            --i;
+        }
+        beginRemoveRows(QModelIndex(), i, last);
+        m_matches.erase(m_matches.begin() + i, m_matches.begin() + last + 1);
+        endRemoveRows();
+    }
+
+    // Now every row left is in the new list too: move them in place and
+    // insert the new ones around them
+    QSet<QString> current = m_matches.toSet();
+    for (int i = 0; i < matches.count(); ++i) {
+        const QString &match = matches.at(i);
+        if (i < m_matches.count() && m_matches.at(i) == match) {
+            continue;
+        }
+
+        if (current.contains(match)) {
+            int from = m_matches.indexOf(match, i + 1);
+            beginMoveRows(QModelIndex(), from, from, QModelIndex(), i);
+            m_matches.move(from, i);
+            endMoveRows();
+        } else {
+            int last = i;
+            while (last + 1 < matches.count() && !current.contains(matches.at(last + 1))) {
+                ++last;
+            }
+            beginInsertRows(QModelIndex(), i, last);
+            for (int j = i; j <= last; ++j) {
+                m_matches.insert(j, matches.at(j));
             }
+            endInsertRows();
+            i = last;
         }
     }
-    beginInsertRows(QModelIndex(), 0, matches.count());
-    m_matches = matches;
-    endInsertRows();
+}
+
+int MatcherModel::frecency(const QString &name, qint64 now) const
+{
+    auto it = m_history.constFind(name);
+    if (it == m_history.constEnd()) {
+        return 0;
+    }
+
+    // Recent launches weigh more than old ones
+    static const qint64 day = 24 * 60 * 60 * 1000;
+    qint64 age = now - it->lastUsed;
+    int weight = age < 4 * day ? 100 : age < 14 * day ? 70 : age < 31 * day ? 50 : age < 90 * day ? 30 : 10;
+    return it->count * weight;
 }
 
 void MatcherModel::addInHistory(const QString &command)
 {
-    if (!command.isEmpty()) {
-        m_items.removeOne(command);
-        m_items.prepend(command);
+    if (command.isEmpty()) {
+        return;
+    }
+
+    Usage &usage = m_history[command];
+    ++usage.count;
+    usage.lastUsed = QDateTime::currentMSecsSinceEpoch();
+    saveHistory();
+
+    Item key = { command, QString(), 0 };
+    auto it = std::lower_bound(m_items.begin(), m_items.end(), key, [](const Item &a, const Item &b) { return a.name < b.name; });
+    if (it != m_items.end() && it->name == command) {
+        it->frecency = frecency(command, usage.lastUsed);
+        m_candidatesValid = false;
+        matchExpression();
+    } else {
+        buildItemsList();
+    }
+}
+
+static QString historyFile()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation) + QStringLiteral("/orbital/launcher_history");
+}
+
+void MatcherModel::loadHistory()
+{
+    QFile file(historyFile());
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    QTextStream stream(&file);
+    while (!stream.atEnd()) {
+        QStringList fields = stream.readLine().split(' ');
+        if (fields.count() < 3) {
+            continue;
+        }
+        Usage usage = { fields.at(0).toInt(), fields.at(1).toLongLong() };
+        if (usage.count > 0) {
+            m_history.insert(QStringList(fields.mid(2)).join(' '), usage);
+        }
+    }
+}
+
+void MatcherModel::saveHistory()
+{
+    QString path = historyFile();
+    QDir().mkpath(QFileInfo(path).path());
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning("Cannot write the launcher history file %s.", qPrintable(path));
+        return;
+    }
+
+    QTextStream stream(&file);
+    for (auto it = m_history.constBegin(); it != m_history.constEnd(); ++it) {
+        stream << it->count << ' ' << it->lastUsed << ' ' << it.key() << '\n';
     }
+    stream.flush();
+    file.commit();
 }
@@ -21,7 +21,9 @@
 #define ORBITAL_LAUNCHER_MATCHER_MODEL_H
 
 #include <QAbstractListModel>
-#include <QLinkedList>
+#include <QThreadPool>
+#include <QVector>
+#include <QHash>
 
 
 class QFileSystemWatcher;
@@ -32,6 +34,7 @@ class MatcherModel : public QAbstractListModel
     Q_PROPERTY(QString expression READ expression WRITE setExpression)
 public:
     MatcherModel();
+    ~MatcherModel();
 
     void setCommandPrefix(const QString &prefix);
     void addCommand(const QString &command);
@@ -44,16 +47,40 @@ public:
 
     void addInHistory(const QString &command);
 
+private slots:
+    void scanDirectory(const QString &path);
+    void directoryScanned(const QString &path, const QStringList &items);
+
 private:
+    struct Item {
+        QString name;
+        QString key;
+        int frecency;
+    };
+    struct Usage {
+        int count;
+        qint64 lastUsed;
+    };
+
     void buildItemsList();
     void matchExpression();
+    void setMatches(const QStringList &matches);
+    int frecency(const QString &name, qint64 now) const;
+    void loadHistory();
+    void saveHistory();
 
     QString m_expression;
-    QStringList m_items;
+    QVector<Item> m_items;
+    QVector<int> m_candidates;
+    QString m_candidatesQuery;
+    bool m_candidatesValid;
     QStringList m_matches;
     QString m_commandPrefix;
     QStringList m_commands;
     QFileSystemWatcher *m_watcher;
+    QHash<QString, QStringList> m_directories;
+    QHash<QString, Usage> m_history;
+    QThreadPool m_pool;
 };
 
 #endif
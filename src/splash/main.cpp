@@ -119,7 +119,11 @@ const desktop_shell_splash_listener Splash::s_splashListener = {
     }
 };
 
+#ifdef ORBITAL_ZYGOTE_MODULE
+extern "C" int orbital_zygote_main(int argc, char *argv[])
+#else
 int main(int argc, char *argv[])
+#endif
 {
     QGuiApplication app(argc, argv);
     Splash splash;
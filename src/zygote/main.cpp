@@ -0,0 +1,233 @@
+/*
+ * Copyright 2015 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This file is part of Orbital
+ *
+ * Orbital is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Orbital is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Orbital.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * orbital-zygote keeps Qt and the shell helpers' code loaded and relocated,
+ * and forks a new helper every time the compositor asks for one, so that
+ * they don't pay the dynamic linking cost at every start.
+ * A helper can be started by the zygote if it is built as a module exporting
+ * orbital_zygote_main() in LIBRARIES_PATH/zygote/<program name>.so. Other
+ * programs are simply exec'd.
+ * The zygote must stay single threaded, so nothing here may create a
+ * Q(Core)Application or anything else that may spawn threads.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <dlfcn.h>
+#include <libgen.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+
+#include <QByteArray>
+#include <QDir>
+#include <QFileInfo>
+#include <QHash>
+#include <QLibraryInfo>
+#include <QList>
+#include <QStringList>
+
+typedef int (*ZygoteMain)(int argc, char **argv);
+
+static QHash<QByteArray, ZygoteMain> s_modules;
+
+static void preload(const QString &path)
+{
+    if (!dlopen(qPrintable(path), RTLD_NOW | RTLD_GLOBAL)) {
+        fprintf(stderr, "orbital-zygote: cannot preload %s: %s\n", qPrintable(path), dlerror());
+    }
+}
+
+static void loadModules()
+{
+    QDir dir(QStringLiteral(LIBRARIES_PATH "/zygote"));
+    foreach (const QFileInfo &fi, dir.entryInfoList({ QStringLiteral("*.so") }, QDir::Files)) {
+        void *handle = dlopen(qPrintable(fi.absoluteFilePath()), RTLD_NOW | RTLD_GLOBAL);
+        if (!handle) {
+            fprintf(stderr, "orbital-zygote: cannot load %s: %s\n", qPrintable(fi.absoluteFilePath()), dlerror());
+            continue;
+        }
+        ZygoteMain main = reinterpret_cast<ZygoteMain>(dlsym(handle, "orbital_zygote_main"));
+        if (!main) {
+            fprintf(stderr, "orbital-zygote: %s has no orbital_zygote_main()\n", qPrintable(fi.absoluteFilePath()));
+            continue;
+        }
+        s_modules.insert(fi.completeBaseName().toUtf8(), main);
+    }
+
+    // The helpers will load these anyway. Loading them now means the children
+    // find them already mapped and relocated, and dlopen() is a no-op.
+    QString plugins = QLibraryInfo::location(QLibraryInfo::PluginsPath);
+    preload(plugins + QStringLiteral("/platforms/libqwayland-generic.so"));
+    QString qml = QLibraryInfo::location(QLibraryInfo::Qml2ImportsPath);
+    preload(qml + QStringLiteral("/QtQuick.2/libqtquick2plugin.so"));
+    preload(qml + QStringLiteral("/QtQuick/Window.2/libwindowplugin.so"));
+    preload(qml + QStringLiteral("/QtQuick/Layouts/libqquicklayoutsplugin.so"));
+    preload(qml + QStringLiteral("/QtQuick/Controls/libqtquickcontrolsplugin.so"));
+}
+
+// A request is a single packet made of NUL terminated strings: the program,
+// the number of arguments, the arguments and the environment. The Wayland
+// socket for the child comes with it as ancillary data.
+static bool readRequest(int socket, QByteArray &buf, QList<QByteArray> &fields, int *fd)
+{
+    char control[CMSG_SPACE(sizeof(int))];
+
+    // The environment can be arbitrarily big, peek at the packet size first.
+    ssize_t len;
+    do {
+        len = recv(socket, nullptr, 0, MSG_PEEK | MSG_TRUNC);
+    } while (len < 0 && errno == EINTR);
+    if (len <= 0) {
+        // the compositor went away
+        exit(len < 0 ? 1 : 0);
+    }
+    if (buf.size() < len) {
+        buf.resize(len);
+    }
+
+    iovec iov = { buf.data(), (size_t)buf.size() };
+    msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    do {
+        len = recvmsg(socket, &msg, MSG_CMSG_CLOEXEC);
+    } while (len < 0 && errno == EINTR);
+    if (len <= 0) {
+        exit(len < 0 ? 1 : 0);
+    }
+
+    *fd = -1;
+    for (cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            memcpy(fd, CMSG_DATA(cmsg), sizeof(int));
+        }
+    }
+
+    if (msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC) || *fd < 0) {
+        fprintf(stderr, "orbital-zygote: malformed request\n");
+        if (*fd >= 0) {
+            close(*fd);
+        }
+        return false;
+    }
+
+    fields = QByteArray::fromRawData(buf.constData(), len).split('\0');
+    // split() leaves an empty field after the last terminator
+    fields.removeLast();
+    return true;
+}
+
+// The compositor blocks until it gets an answer, so every request must have
+// one. -1 tells it to start the program by itself.
+static void reply(int socket, pid_t pid)
+{
+    send(socket, &pid, sizeof(pid), MSG_NOSIGNAL);
+}
+
+static void runChild(const QList<QByteArray> &fields, int fd)
+{
+    signal(SIGCHLD, SIG_DFL);
+    setpriority(PRIO_PROCESS, getpid(), 0);
+
+    const QByteArray &program = fields.at(0);
+    int argc = fields.at(1).toInt();
+
+    // the strings must outlive the child's main(), leak them
+    char **argv = new char *[argc + 1];
+    for (int i = 0; i < argc; ++i) {
+        argv[i] = strdup(fields.at(2 + i).constData());
+    }
+    argv[argc] = nullptr;
+
+    clearenv();
+    for (int i = 2 + argc; i < fields.count(); ++i) {
+        putenv(strdup(fields.at(i).constData()));
+    }
+
+    // the fd we got is CLOEXEC, the exec'd program needs one that is not
+    int socket = dup(fd);
+    close(fd);
+    char env[32];
+    snprintf(env, sizeof(env), "%d", socket);
+    setenv("WAYLAND_SOCKET", env, 1);
+
+    QByteArray name = program;
+    if (ZygoteMain main = s_modules.value(basename(name.data()))) {
+        exit(main(argc, argv));
+    }
+
+    execv(program.constData(), argv);
+    fprintf(stderr, "orbital-zygote: failed to exec %s: %s\n", program.constData(), strerror(errno));
+    _exit(127);
+}
+
+int main(int argc, char **argv)
+{
+    const char *socketEnv = getenv("ORBITAL_ZYGOTE_SOCKET");
+    if (!socketEnv) {
+        fprintf(stderr, "orbital-zygote: this program is meant to be run by the Orbital compositor.\n");
+        return 1;
+    }
+    int socket = atoi(socketEnv);
+    unsetenv("ORBITAL_ZYGOTE_SOCKET");
+    fcntl(socket, F_SETFD, FD_CLOEXEC);
+
+    // let the kernel reap the children
+    signal(SIGCHLD, SIG_IGN);
+
+    loadModules();
+
+    QByteArray buf;
+    while (true) {
+        QList<QByteArray> fields;
+        int fd;
+        if (!readRequest(socket, buf, fields, &fd)) {
+            reply(socket, -1);
+            continue;
+        }
+        if (fields.count() < 2 || fields.count() < 2 + fields.at(1).toInt()) {
+            fprintf(stderr, "orbital-zygote: malformed request\n");
+            close(fd);
+            reply(socket, -1);
+            continue;
+        }
+
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(socket);
+            runChild(fields, fd);
+        } else if (pid < 0) {
+            fprintf(stderr, "orbital-zygote: fork failed: %s\n", strerror(errno));
+        }
+        close(fd);
+        reply(socket, pid);
+    }
+
+    return 0;
+}